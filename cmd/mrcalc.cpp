@@ -155,46 +155,11 @@ class Evaluator;
 class Chunk : public vector<complex_type> { NOMEMALIGN
   public:
     complex_type value;
-};
-
 
-class ThreadLocalStorageItem { NOMEMALIGN
-  public:
-    Chunk chunk;
-    copy_ptr<Image<complex_type>> image;
-};
-
-class ThreadLocalStorage : public vector<ThreadLocalStorageItem> { NOMEMALIGN
-  public:
-
-      void load (Chunk& chunk, Image<complex_type>& image) {
-        for (size_t n = 0; n < image.ndim(); ++n)
-          if (image.size(n) > 1)
-            image.index(n) = iter->index(n);
-
-        size_t n = 0;
-        for (size_t y = 0; y < size[1]; ++y) {
-          if (axes[1] < image.ndim()) if (image.size (axes[1]) > 1) image.index(axes[1]) = y;
-          for (size_t x = 0; x < size[0]; ++x) {
-            if (axes[0] < image.ndim()) if (image.size (axes[0]) > 1) image.index(axes[0]) = x;
-            chunk[n++] = image.value();
-          }
-        }
-      }
-
-    Chunk& next () {
-      ThreadLocalStorageItem& item ((*this)[current++]);
-      if (item.image) load (item.chunk, *item.image);
-      return item.chunk;
-    }
-
-    void reset (const Iterator& current_position) { current = 0; iter = &current_position; }
-
-    const Iterator* iter;
-    vector<size_t> axes, size;
-
-  private:
-    size_t current;
+    // pointer & stride to use when iterating over the chunk, so that scalar
+    // values can be handled without branching within the inner loop:
+    const complex_type* begin_ptr () const { return size() ? data() : &value; }
+    size_t stride () const { return size() ? 1 : 0; }
 };
 
 
@@ -271,8 +236,6 @@ class StackEntry { NOMEMALIGN
     bool is_complex () const;
 
     static std::map<std::string, LoadedImage> image_list;
-
-    Chunk& evaluate (ThreadLocalStorage& storage) const;
 };
 
 std::map<std::string, LoadedImage> StackEntry::image_list;
@@ -291,17 +254,10 @@ class Evaluator { NOMEMALIGN
     bool ZtoR, RtoZ;
     vector<StackEntry> operands;
 
-    Chunk& evaluate (ThreadLocalStorage& storage) const {
-      Chunk& in1 (operands[0].evaluate (storage));
-      if (num_args() == 1) return evaluate (in1);
-      Chunk& in2 (operands[1].evaluate (storage));
-      if (num_args() == 2) return evaluate (in1, in2);
-      Chunk& in3 (operands[2].evaluate (storage));
-      return evaluate (in1, in2, in3);
-    }
-    virtual Chunk& evaluate (Chunk& in) const { throw Exception ("operation \"" + id + "\" not supported!"); return in; }
-    virtual Chunk& evaluate (Chunk& a, Chunk& b) const { throw Exception ("operation \"" + id + "\" not supported!"); return a; }
-    virtual Chunk& evaluate (Chunk& a, Chunk& b, Chunk& c) const { throw Exception ("operation \"" + id + "\" not supported!"); return a; }
+    // the output chunk may be the same as one of the input chunks:
+    virtual void evaluate (Chunk& out, const Chunk& in) const { throw Exception ("operation \"" + id + "\" not supported!"); }
+    virtual void evaluate (Chunk& out, const Chunk& a, const Chunk& b) const { throw Exception ("operation \"" + id + "\" not supported!"); }
+    virtual void evaluate (Chunk& out, const Chunk& a, const Chunk& b, const Chunk& c) const { throw Exception ("operation \"" + id + "\" not supported!"); }
 
     virtual bool is_complex () const {
       for (size_t n = 0; n < operands.size(); ++n)
@@ -324,25 +280,6 @@ inline bool StackEntry::is_complex () const {
 
 
 
-inline Chunk& StackEntry::evaluate (ThreadLocalStorage& storage) const
-{
-  if (evaluator) return evaluator->evaluate (storage);
-  if (rng) {
-    Chunk& chunk = storage.next();
-    if (rng_gaussian) {
-      std::normal_distribution<real_type> dis (0.0, 1.0);
-      for (size_t n = 0; n < chunk.size(); ++n)
-        chunk[n] = dis (*rng);
-    }
-    else {
-      std::uniform_real_distribution<real_type> dis (0.0, 1.0);
-      for (size_t n = 0; n < chunk.size(); ++n)
-        chunk[n] = dis (*rng);
-    }
-    return chunk;
-  }
-  return storage.next();
-}
 
 
 
@@ -396,19 +333,19 @@ class UnaryEvaluator : public Evaluator { NOMEMALIGN
       Evaluator (name, operation.format, operation.ZtoR, operation.RtoZ),
       op (operation) {
         operands.push_back (operand);
+        complex_operands = operand.is_complex();
       }
 
     Operation op;
+    bool complex_operands;
 
-    virtual Chunk& evaluate (Chunk& in) const {
-      if (operands[0].is_complex())
-        for (size_t n = 0; n < in.size(); ++n)
-          in[n] = op.Z (in[n]);
+    virtual void evaluate (Chunk& out, const Chunk& in) const {
+      if (complex_operands)
+        for (size_t n = 0; n < out.size(); ++n)
+          out[n] = op.Z (in[n]);
       else
-        for (size_t n = 0; n < in.size(); ++n)
-          in[n] = op.R (in[n].real());
-
-      return in;
+        for (size_t n = 0; n < out.size(); ++n)
+          out[n] = op.R (in[n].real());
     }
 };
 
@@ -425,25 +362,23 @@ class BinaryEvaluator : public Evaluator { NOMEMALIGN
       op (operation) {
         operands.push_back (operand1);
         operands.push_back (operand2);
+        complex_operands = operand1.is_complex() || operand2.is_complex();
       }
 
     Operation op;
+    bool complex_operands;
 
-    virtual Chunk& evaluate (Chunk& a, Chunk& b) const {
-      Chunk& out (a.size() ? a : b);
-      if (operands[0].is_complex() || operands[1].is_complex()) {
+    virtual void evaluate (Chunk& out, const Chunk& a, const Chunk& b) const {
+      const complex_type* pa = a.begin_ptr(), *pb = b.begin_ptr();
+      const size_t sa = a.stride(), sb = b.stride();
+      if (complex_operands) {
         for (size_t n = 0; n < out.size(); ++n)
-          out[n] = op.Z (
-              a.size() ? a[n] : a.value,
-              b.size() ? b[n] : b.value );
+          out[n] = op.Z (pa[n*sa], pb[n*sb]);
       }
       else {
         for (size_t n = 0; n < out.size(); ++n)
-          out[n] = op.R (
-              a.size() ? a[n].real() : a.value.real(),
-              b.size() ? b[n].real() : b.value.real() );
+          out[n] = op.R (pa[n*sa].real(), pb[n*sb].real());
       }
-      return out;
     }
 
 };
@@ -459,27 +394,23 @@ class TernaryEvaluator : public Evaluator { NOMEMALIGN
         operands.push_back (operand1);
         operands.push_back (operand2);
         operands.push_back (operand3);
+        complex_operands = operand1.is_complex() || operand2.is_complex() || operand3.is_complex();
       }
 
     Operation op;
+    bool complex_operands;
 
-    virtual Chunk& evaluate (Chunk& a, Chunk& b, Chunk& c) const {
-      Chunk& out (a.size() ? a : (b.size() ? b : c));
-      if (operands[0].is_complex() || operands[1].is_complex() || operands[2].is_complex()) {
+    virtual void evaluate (Chunk& out, const Chunk& a, const Chunk& b, const Chunk& c) const {
+      const complex_type* pa = a.begin_ptr(), *pb = b.begin_ptr(), *pc = c.begin_ptr();
+      const size_t sa = a.stride(), sb = b.stride(), sc = c.stride();
+      if (complex_operands) {
         for (size_t n = 0; n < out.size(); ++n)
-          out[n] = op.Z (
-              a.size() ? a[n] : a.value,
-              b.size() ? b[n] : b.value,
-              c.size() ? c[n] : c.value );
+          out[n] = op.Z (pa[n*sa], pb[n*sb], pc[n*sc]);
       }
       else {
         for (size_t n = 0; n < out.size(); ++n)
-          out[n] = op.R (
-              a.size() ? a[n].real() : a.value.real(),
-              b.size() ? b[n].real() : b.value.real(),
-              c.size() ? c[n].real() : c.value.real() );
+          out[n] = op.R (pa[n*sa].real(), pb[n*sb].real(), pc[n*sc].real());
       }
-      return out;
     }
 
 };
@@ -633,60 +564,198 @@ void get_header (const StackEntry& entry, Header& header)
 
 
 
+// The expression tree is compiled into a flat sequence of instructions, each
+// of which writes its output into one of a set of per-thread chunks
+// (registers). Identical sub-expressions (other than random numbers) are
+// only evaluated once, and registers are re-used as soon as their contents
+// are no longer needed, so that the memory required per thread is bounded by
+// the number of intermediate results that need to be held simultaneously,
+// rather than by the size of the expression.
+class Program { NOMEMALIGN
+  public:
+    class Instruction { NOMEMALIGN
+      public:
+        const StackEntry* entry;
+        vector<size_t> operands;
+        size_t output;
+    };
+
+    Program (const StackEntry& top_of_stack) :
+      num_registers (0),
+      num_rng (0) {
+        const size_t top = compile (top_of_stack);
+
+        // index of the last instruction to make use of each result:
+        vector<size_t> last_use (instructions.size(), 0);
+        for (size_t i = 0; i < instructions.size(); ++i)
+          for (const auto operand : instructions[i].operands)
+            last_use[operand] = i;
+        last_use[top] = instructions.size();
+
+        // assign registers, re-using those that are no longer needed:
+        vector<size_t> free_registers;
+        for (size_t i = 0; i < instructions.size(); ++i) {
+          auto& instruction (instructions[i]);
+          if (!instruction.entry->evaluator && !instruction.entry->image && !instruction.entry->rng) {
+            instruction.output = num_registers++;
+            continue;
+          }
+          for (size_t n = 0; n < instruction.operands.size(); ++n) {
+            const size_t operand = instruction.operands[n];
+            if (last_use[operand] == i && is_chunk (operand) &&
+                std::find (instruction.operands.begin(), instruction.operands.begin()+n, operand) == instruction.operands.begin()+n)
+              free_registers.push_back (instructions[operand].output);
+          }
+          if (free_registers.size()) {
+            instruction.output = free_registers.back();
+            free_registers.pop_back();
+          }
+          else
+            instruction.output = num_registers++;
+        }
+
+        // map operands from instruction index to register index:
+        for (auto& instruction : instructions)
+          for (auto& operand : instruction.operands)
+            operand = instructions[operand].output;
+        output = instructions[top].output;
+
+        DEBUG ("expression compiled to " + str(instructions.size()) + " instructions using " + str(num_registers) + " registers");
+      }
+
+    vector<Instruction> instructions;
+    size_t num_registers, output;
+
+  private:
+    std::map<std::string, size_t> subexpressions;
+    size_t num_rng;
+
+    bool is_chunk (size_t index) const {
+      const StackEntry& entry (*instructions[index].entry);
+      return entry.evaluator || entry.image || entry.rng;
+    }
+
+    // returns index of instruction computing this entry, adding it if not already present:
+    size_t compile (const StackEntry& entry) {
+      Instruction instruction;
+      instruction.entry = &entry;
+      std::string key;
+      if (entry.evaluator) {
+        key = entry.evaluator->id + "(";
+        for (const auto& operand : entry.evaluator->operands) {
+          instruction.operands.push_back (compile (operand));
+          key += str(instruction.operands.back()) + ",";
+        }
+        key += ")";
+      }
+      else if (entry.image)
+        key = "image:" + str(entry.image.get());
+      else if (entry.rng)
+        key = "rng:" + str(num_rng++);
+      else
+        key = "value:" + std::string (reinterpret_cast<const char*> (&entry.value), sizeof (entry.value));
+
+      auto existing = subexpressions.find (key);
+      if (existing != subexpressions.end())
+        return existing->second;
+      subexpressions.insert (std::make_pair (key, instructions.size()));
+      instructions.push_back (instruction);
+      return instructions.size() - 1;
+    }
+};
+
+
+
+
 class ThreadFunctor { NOMEMALIGN
   public:
     ThreadFunctor (
         const vector<size_t>& inner_axes,
-        const StackEntry& top_of_stack,
+        const Program& compiled_program,
         Image<complex_type>& output_image) :
-      top_entry (top_of_stack),
+      program (compiled_program),
       image (output_image),
-      loop (Loop (inner_axes)) {
-        storage.axes = loop.axes;
-        storage.size.push_back (image.size(storage.axes[0]));
-        storage.size.push_back (image.size(storage.axes[1]));
-        chunk_size = image.size (storage.axes[0]) * image.size (storage.axes[1]);
-        allocate_storage (top_entry);
+      loop (Loop (inner_axes)),
+      registers (program.num_registers),
+      images (program.instructions.size()) {
+        axes = loop.axes;
+        size[0] = image.size (axes[0]);
+        size[1] = image.size (axes[1]);
+        const size_t chunk_size = size[0] * size[1];
+        for (size_t i = 0; i < program.instructions.size(); ++i) {
+          const auto& instruction (program.instructions[i]);
+          const StackEntry& entry (*instruction.entry);
+          if (entry.evaluator || entry.image || entry.rng)
+            registers[instruction.output].resize (chunk_size);
+          else
+            registers[instruction.output].value = entry.value;
+          if (entry.image)
+            images[i].reset (new Image<complex_type> (*entry.image));
+        }
       }
 
-    void allocate_storage (const StackEntry& entry) {
-      if (entry.evaluator) {
-        for (size_t n = 0; n < entry.evaluator->operands.size(); ++n)
-          allocate_storage (entry.evaluator->operands[n]);
-        return;
-      }
 
-      storage.push_back (ThreadLocalStorageItem());
-      if (entry.image) {
-        storage.back().image.reset (new Image<complex_type> (*entry.image));
-        storage.back().chunk.resize (chunk_size);
-        return;
-      }
-      else if (entry.rng) {
-        storage.back().chunk.resize (chunk_size);
+    void load (Chunk& chunk, Image<complex_type>& source, const Iterator& iter) {
+      for (size_t n = 0; n < source.ndim(); ++n)
+        if (source.size(n) > 1)
+          source.index(n) = iter.index(n);
+
+      size_t n = 0;
+      for (ssize_t y = 0; y < size[1]; ++y) {
+        if (axes[1] < source.ndim()) if (source.size (axes[1]) > 1) source.index(axes[1]) = y;
+        for (ssize_t x = 0; x < size[0]; ++x) {
+          if (axes[0] < source.ndim()) if (source.size (axes[0]) > 1) source.index(axes[0]) = x;
+          chunk[n++] = source.value();
+        }
       }
-      else storage.back().chunk.value = entry.value;
     }
 
 
     void operator() (const Iterator& iter) {
-      storage.reset (iter);
       assign_pos_of (iter).to (image);
 
-      Chunk& chunk = top_entry.evaluate (storage);
+      for (size_t i = 0; i < program.instructions.size(); ++i) {
+        const auto& instruction (program.instructions[i]);
+        const StackEntry& entry (*instruction.entry);
+        Chunk& chunk (registers[instruction.output]);
+        if (entry.evaluator) {
+          const auto& in (instruction.operands);
+          switch (in.size()) {
+            case 1: entry.evaluator->evaluate (chunk, registers[in[0]]); break;
+            case 2: entry.evaluator->evaluate (chunk, registers[in[0]], registers[in[1]]); break;
+            default: entry.evaluator->evaluate (chunk, registers[in[0]], registers[in[1]], registers[in[2]]); break;
+          }
+        }
+        else if (images[i])
+          load (chunk, *images[i], iter);
+        else if (entry.rng) {
+          if (entry.rng_gaussian) {
+            std::normal_distribution<real_type> dis (0.0, 1.0);
+            for (size_t n = 0; n < chunk.size(); ++n)
+              chunk[n] = dis (*entry.rng);
+          }
+          else {
+            std::uniform_real_distribution<real_type> dis (0.0, 1.0);
+            for (size_t n = 0; n < chunk.size(); ++n)
+              chunk[n] = dis (*entry.rng);
+          }
+        }
+      }
 
-      auto value = chunk.cbegin();
+      auto value = registers[program.output].cbegin();
       for (auto l = loop (image); l; ++l)
         image.value() = *(value++);
     }
 
 
 
-    const StackEntry& top_entry;
+    const Program& program;
     Image<complex_type> image;
     decltype (Loop (vector<size_t>())) loop;
-    ThreadLocalStorage storage;
-    size_t chunk_size;
+    vector<size_t> axes;
+    ssize_t size[2];
+    vector<Chunk> registers;
+    vector<copy_ptr<Image<complex_type>>> images;
 };
 
 
@@ -730,7 +799,8 @@ void run_operations (const vector<StackEntry>& stack)
 
   auto loop = ThreadedLoop ("computing: " + operation_string(stack[0]), output, 0, output.ndim(), 2);
 
-  ThreadFunctor functor (loop.inner_axes, stack[0], output);
+  Program program (stack[0]);
+  ThreadFunctor functor (loop.inner_axes, program, output);
   loop.run_outer (functor);
 }
 
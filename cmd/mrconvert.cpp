@@ -284,6 +284,15 @@ void copy_permute (const InputType& in, Header& header_out, const std::string& o
   auto out = Image<T>::create (output_filename, header_out);
   DWI::export_grad_commandline (out);
   PhaseEncoding::export_commandline (out);
+  bool identity = ( axes.size() == in.ndim() );
+  for (size_t n = 0; identity && n < axes.size(); ++n)
+    identity = ( axes[n] == int(n) );
+  if (identity) {
+    // copy directly, allowing for bulk conversion between data types:
+    InputType source (in);
+    threaded_copy_with_progress (source, out, 0, std::numeric_limits<size_t>::max(), 2);
+    return;
+  }
   auto perm = Adapter::make <Adapter::PermuteAxes> (in, axes);
   threaded_copy_with_progress (perm, out, 0, std::numeric_limits<size_t>::max(), 2);
 }
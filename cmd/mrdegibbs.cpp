@@ -13,13 +13,12 @@
  */
 
 
-#include <unsupported/Eigen/FFT>
-
 #include "axes.h"
 #include "command.h"
 #include "image.h"
 #include "progressbar.h"
 #include "algo/threaded_loop.h"
+#include "math/fft.h"
 #include <numeric>
 
 using namespace MR;
@@ -95,23 +94,11 @@ class ComputeSlice
       in (in),
       out (out),
       im1 (in.size(slice_axes[0]), in.size(slice_axes[1])),
-      im2 (im1.rows(), im1.cols()) {
-        prealloc_FFT();
-      }
-
-    ComputeSlice (const ComputeSlice& other) :
-      outer_axes (other.outer_axes),
-      slice_axes (other.slice_axes),
-      nsh (other.nsh),
-      minW (other.minW),
-      maxW (other.maxW),
-      in (other.in),
-      out (other.out),
-      fft (),
-      im1 (in.size(slice_axes[0]), in.size(slice_axes[1])),
-      im2 (im1.rows(), im1.cols()) {
-        prealloc_FFT();
-      }
+      im2 (im1.rows(), im1.cols()),
+      fft_rows (im1.cols(), false),
+      ifft_rows (im1.cols(), true),
+      fft_cols (im1.rows(), false),
+      ifft_cols (im1.rows(), true) { }
 
 
     void operator() (const Iterator& pos)
@@ -134,38 +121,16 @@ class ComputeSlice
     const vector<size_t>& slice_axes;
     const int nsh, minW, maxW;
     Image<value_type> in, out;
-    Eigen::FFT<double> fft;
     Eigen::MatrixXcd im1, im2, shifted;
-    Eigen::VectorXcd v;
-
-    void prealloc_FFT () {
-      // needed to avoid within-thread allocations,
-      // which aren't thread-safe in FFTW:
-#ifdef EIGEN_FFTW_DEFAULT
-      Eigen::VectorXcd tmp (im1.rows());
-      FFT (tmp);
-      iFFT (tmp);
-      tmp.resize (im1.cols());
-      FFT (tmp);
-      iFFT (tmp);
-#endif
-    }
-
-    template <typename Derived> FORCE_INLINE void FFT      (Eigen::MatrixBase<Derived>&& vec) { fft.fwd (v, vec); vec = v; }
-    template <typename Derived> FORCE_INLINE void FFT      (Eigen::MatrixBase<Derived>& vec) { FFT (std::move (vec)); }
-    template <typename Derived> FORCE_INLINE void iFFT     (Eigen::MatrixBase<Derived>&& vec) { fft.inv (v, vec); vec = v; }
-    template <typename Derived> FORCE_INLINE void iFFT     (Eigen::MatrixBase<Derived>& vec) { iFFT (std::move (vec)); }
-    template <typename Derived> FORCE_INLINE void row_FFT  (Eigen::MatrixBase<Derived>& mat) { for (auto n = 0; n < mat.rows(); ++n)  FFT (mat.row(n)); }
-    template <typename Derived> FORCE_INLINE void row_iFFT (Eigen::MatrixBase<Derived>& mat) { for (auto n = 0; n < mat.rows(); ++n) iFFT (mat.row(n)); }
-    template <typename Derived> FORCE_INLINE void col_FFT  (Eigen::MatrixBase<Derived>& mat) { for (auto n = 0; n < mat.cols(); ++n)  FFT (mat.col(n)); }
-    template <typename Derived> FORCE_INLINE void col_iFFT (Eigen::MatrixBase<Derived>& mat) { for (auto n = 0; n < mat.cols(); ++n) iFFT (mat.col(n)); }
+    // batched transforms along all rows / columns of a matrix:
+    Math::FFT<double> fft_rows, ifft_rows, fft_cols, ifft_cols;
 
 
 
     FORCE_INLINE void unring_2d ()
     {
-      row_FFT (im1);
-      col_FFT (im1);
+      fft_rows.rows (im1);
+      fft_cols.cols (im1);
 
       for (int k = 0; k < im1.cols(); k++) {
         double ck = (1.0+cos(2.0*Math::pi*(double(k)/im1.cols())))*0.5;
@@ -181,11 +146,11 @@ class ComputeSlice
         }
       }
 
-      row_iFFT (im1);
-      col_iFFT (im2);
+      ifft_rows.rows (im1);
+      ifft_cols.cols (im2);
 
-      unring_1d (im1);
-      unring_1d (im2.transpose());
+      unring_1d (im1, ifft_cols);
+      unring_1d (im2.transpose(), ifft_rows);
 
       im1 += im2;
     }
@@ -195,7 +160,7 @@ class ComputeSlice
 
 
     template <typename Derived>
-      FORCE_INLINE void unring_1d (Eigen::MatrixBase<Derived>&& eig)
+      FORCE_INLINE void unring_1d (Eigen::MatrixBase<Derived>&& eig, Math::FFT<double>& ifft)
       {
         const int n = eig.rows();
         const int numlines = eig.cols();
@@ -233,7 +198,7 @@ class ComputeSlice
           }
 
 
-          col_iFFT (shifted);
+          ifft.cols (shifted);
 
           for (int j = 0; j < 2*nsh+1; ++j) {
             TV1arr[j] = 0.0;
@@ -288,7 +253,7 @@ class ComputeSlice
       }
 
     template <typename Derived>
-      FORCE_INLINE void unring_1d (Eigen::MatrixBase<Derived>& eig) { unring_1d (std::move (eig)); }
+      FORCE_INLINE void unring_1d (Eigen::MatrixBase<Derived>& eig, Math::FFT<double>& ifft) { unring_1d (std::move (eig), ifft); }
 
 };
 
@@ -70,7 +70,12 @@ const OptionGroup MedianOption = OptionGroup ("Options for median filter")
   + Option ("extent", "specify extent of median filtering neighbourhood in voxels. "
         "This can be specified either as a single value to be used for all 3 axes, "
         "or as a comma-separated list of 3 values, one for each axis (default: 3x3x3).")
-    + Argument ("size").type_sequence_int();
+    + Argument ("size").type_sequence_int()
+
+  + Option ("percentile", "compute the specified percentile of the values within the neighbourhood "
+        "rather than the median, e.g. 0 for a minimum filter or 100 for a maximum filter; "
+        "values at intermediate ranks are linearly interpolated (default: 50).")
+    + Argument ("value").type_float (0.0, 100.0);
 
 const OptionGroup NormaliseOption = OptionGroup ("Options for normalisation filter")
 
@@ -98,7 +103,12 @@ const OptionGroup SmoothOption = OptionGroup ("Options for smooth filter")
             "This can be specified either as a single value to be used for all axes, "
             "or as a comma-separated list of the extent for each axis. "
             "The default extent is 2 * ceil(2.5 * stdev / voxel_size) - 1.")
-  + Argument ("voxels").type_sequence_int();
+  + Argument ("voxels").type_sequence_int()
+
+  + Option ("recursive", "use a recursive approximation to the Gaussian kernel, "
+            "the computational cost of which does not depend on its width; "
+            "this is considerably faster for large kernels. The kernel is not truncated, "
+            "and so the -extent option cannot be used in conjunction with this option.");
 
 
 
@@ -201,6 +211,9 @@ void run () {
       auto opt = get_options ("extent");
       if (opt.size())
         filter.set_extent (parse_ints (opt[0][0]));
+      opt = get_options ("percentile");
+      if (opt.size())
+        filter.set_percentile (opt[0][0]);
       filter.set_message (std::string("applying ") + std::string(argument[1]) + " filter to image " + std::string(argument[0]));
       Stride::set_from_command_line (filter);
 
@@ -229,8 +242,12 @@ void run () {
         filter.set_stdev (stdevs);
       }
       opt = get_options ("extent");
-      if (opt.size())
+      if (opt.size()) {
+        if (get_options ("recursive").size())
+          throw Exception ("the extent and recursive options are mutually exclusive.");
         filter.set_extent (parse_ints (opt[0][0]));
+      }
+      filter.set_recursive (get_options ("recursive").size());
       filter.set_message (std::string("applying ") + std::string(argument[1]) + " filter to image " + std::string(argument[0]));
       Stride::set_from_command_line (filter);
 
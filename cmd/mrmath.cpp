@@ -61,6 +61,10 @@ void usage ()
     "std (unbiased standard deviation), min, max, absmax (maximum absolute value), "
     "magmax (value with maximum absolute value, preserving its sign)."
 
+    + "Additional operations can be computed in the same pass through the data "
+    "using the -output option; this avoids reading the input data multiple times "
+    "when several summary statistics are required."
+
     + "See also 'mrcalc' to compute per-voxel operations.";
 
   ARGUMENTS
@@ -72,6 +76,11 @@ void usage ()
   + Option ("axis", "perform operation along a specified axis of a single input image")
     + Argument ("index").type_integer (0)
 
+  + Option ("output", "also compute the specified operation in the same pass through the data, "
+      "and write its result to the image specified. This option can be used multiple times.").allow_multiple()
+    + Argument ("operation").type_choice (operations)
+    + Argument ("image").type_image_out ()
+
   + DataType::options();
 }
 
@@ -175,22 +184,24 @@ class NORM2 { NOMEMALIGN
 };
 
 
+// uses Welford's online algorithm for numerical stability
 class Var { NOMEMALIGN
   public:
-    Var () : sum (0.0), sum_sqr (0.0), count (0) { }
+    Var () : mean (0.0), m2 (0.0), count (0) { }
     void operator() (value_type val) {
       if (std::isfinite (val)) {
-        sum += val;
-        sum_sqr += Math::pow2 (val);
         ++count;
+        const double delta = val - mean;
+        mean += delta / count;
+        m2 += delta * (val - mean);
       }
     }
     value_type result () const {
       if (count < 2)
         return NAN;
-      return  (sum_sqr - Math::pow2 (sum) / static_cast<double> (count)) / (static_cast<double> (count) - 1.0);
+      return m2 / (static_cast<double> (count) - 1.0);
     }
-    double sum, sum_sqr;
+    double mean, m2;
     size_t count;
 };
 
@@ -251,6 +262,64 @@ class MagMax { NOMEMALIGN
 
 
 
+// Computes any combination of the above operations in a single pass through the data
+class Multi { NOMEMALIGN
+  public:
+    Multi () : requested (0) { }
+    Multi (const vector<int>& ops) : requested (0) {
+      for (auto op : ops)
+        requested |= 1u << op;
+    }
+    void operator() (value_type val) {
+      if (is_requested (0)) mean (val);
+      if (is_requested (1)) median (val);
+      if (is_requested (2)) sum (val);
+      if (is_requested (3)) product (val);
+      if (is_requested (4)) rms (val);
+      if (is_requested (5)) norm (val);
+      if (is_requested (6) || is_requested (7)) var (val);
+      if (is_requested (8)) min (val);
+      if (is_requested (9)) max (val);
+      if (is_requested (10)) absmax (val);
+      if (is_requested (11)) magmax (val);
+    }
+    value_type result (int op) {
+      switch (op) {
+        case 0: return mean.result();
+        case 1: return median.result();
+        case 2: return sum.result();
+        case 3: return product.result();
+        case 4: return rms.result();
+        case 5: return norm.result();
+        case 6: return var.result();
+        case 7: return std::sqrt (var.result());
+        case 8: return min.result();
+        case 9: return max.result();
+        case 10: return absmax.result();
+        case 11: return magmax.result();
+        default: assert (0); return NAN;
+      }
+    }
+
+  protected:
+    uint32_t requested;
+    Mean mean;
+    Median median;
+    Sum sum;
+    Product product;
+    RMS rms;
+    NORM2 norm;
+    Var var;
+    Min min;
+    Max max;
+    AbsMax absmax;
+    MagMax magmax;
+
+    bool is_requested (int op) const { return requested & (1u << op); }
+};
+
+
+
 
 
 template <class Operation>
@@ -270,6 +339,31 @@ class AxisKernel { NOMEMALIGN
 };
 
 
+class MultiAxisKernel { NOMEMALIGN
+  public:
+    MultiAxisKernel (size_t axis, const vector<int>& ops, const vector<Image<value_type>>& outputs) :
+      axis (axis),
+      ops (ops),
+      outputs (outputs) { }
+
+    template <class InputImageType, class OutputImageType>
+      void operator() (InputImageType& in, OutputImageType& out) {
+        Multi op (ops);
+        for (auto l = Loop (axis) (in); l; ++l)
+          op (in.value());
+        out.value() = op.result (ops[0]);
+        for (size_t n = 1; n < ops.size(); ++n) {
+          assign_pos_of (out).to (outputs[n]);
+          outputs[n].value() = op.result (ops[n]);
+        }
+      }
+  protected:
+    const size_t axis;
+    const vector<int> ops;
+    vector<Image<value_type>> outputs;
+};
+
+
 
 
 
@@ -277,7 +371,7 @@ class ImageKernelBase { NOMEMALIGN
   public:
     virtual ~ImageKernelBase () { }
     virtual void process (Header& image_in) = 0;
-    virtual void write_back (Image<value_type>& out) = 0;
+    virtual void write_back (vector<Image<value_type>>& out) = 0;
 };
 
 
@@ -314,9 +408,10 @@ class ImageKernel : public ImageKernelBase { NOMEMALIGN
         ThreadedLoop (image).run (InitFunctor(), image);
       }
 
-    void write_back (Image<value_type>& out)
+    void write_back (vector<Image<value_type>>& out)
     {
-      ThreadedLoop (image).run (ResultFunctor(), out, image);
+      assert (out.size() == 1);
+      ThreadedLoop (image).run (ResultFunctor(), out[0], image);
     }
 
     void process (Header& header_in)
@@ -331,6 +426,54 @@ class ImageKernel : public ImageKernelBase { NOMEMALIGN
 
 
 
+class MultiImageKernel : public ImageKernelBase { NOMEMALIGN
+  public:
+    MultiImageKernel (const Header& header, const vector<int>& ops) :
+      image (Header::scratch (header).get_image<Multi>()),
+      ops (ops) {
+        const Multi initial (ops);
+        ThreadedLoop (image).run ([&initial] (Image<Multi>& out) { out.value() = initial; }, image);
+      }
+
+    void write_back (vector<Image<value_type>>& out)
+    {
+      assert (out.size() == ops.size());
+      ThreadedLoop (image).run (ResultFunctor (ops, out), image);
+    }
+
+    void process (Header& header_in)
+    {
+      auto in = header_in.get_image<value_type>();
+      ThreadedLoop (image).run ([] (Image<Multi>& out, Image<value_type>& input) {
+          Multi op = out.value();
+          op (input.value());
+          out.value() = op;
+        }, image, in);
+    }
+
+  protected:
+    class ResultFunctor { NOMEMALIGN
+      public:
+        ResultFunctor (const vector<int>& ops, const vector<Image<value_type>>& out) : ops (ops), out (out) { }
+        template <class ImageType>
+          void operator() (ImageType& in) {
+            Multi op = in.value();
+            for (size_t n = 0; n < ops.size(); ++n) {
+              assign_pos_of (in).to (out[n]);
+              out[n].value() = op.result (ops[n]);
+            }
+          }
+      protected:
+        const vector<int>& ops;
+        vector<Image<value_type>> out;
+    };
+
+    Image<Multi> image;
+    const vector<int> ops;
+};
+
+
+
 
 void run ()
 {
@@ -338,7 +481,19 @@ void run ()
   const int op = argument[num_inputs];
   const std::string& output_path = argument.back();
 
-  auto opt = get_options ("axis");
+  // any additional operations to compute in the same pass:
+  vector<int> ops (1, op);
+  vector<std::string> output_paths (1, output_path);
+  auto opt = get_options ("output");
+  for (size_t n = 0; n < opt.size(); ++n) {
+    ops.push_back (int(opt[n][0]));
+    output_paths.push_back (opt[n][1]);
+  }
+  std::string operation_names = operations[op];
+  for (size_t n = 1; n < ops.size(); ++n)
+    operation_names += ", " + std::string (operations[ops[n]]);
+
+  opt = get_options ("axis");
   if (opt.size()) {
 
     if (num_inputs != 1)
@@ -368,7 +523,15 @@ void run ()
 
     auto image_out = Header::create (output_path, header_out).get_image<float>();
 
-    auto loop = ThreadedLoop (std::string("computing ") + operations[op] + " along axis " + str(axis) + "...", image_out);
+    auto loop = ThreadedLoop (std::string("computing ") + operation_names + " along axis " + str(axis) + "...", image_out);
+
+    if (ops.size() > 1) {
+      vector<Image<value_type>> outputs (1, image_out);
+      for (size_t n = 1; n < ops.size(); ++n)
+        outputs.push_back (Header::create (output_paths[n], header_out).get_image<value_type>());
+      loop.run (MultiAxisKernel (axis, ops, outputs), image_in, image_out);
+      return;
+    }
 
     switch (op) {
       case 0: loop.run  (AxisKernel<Mean>   (axis), image_in, image_out); return;
@@ -428,7 +591,9 @@ void run ()
 
     // Instantiate a kernel depending on the operation requested
     std::unique_ptr<ImageKernelBase> kernel;
-    switch (op) {
+    if (ops.size() > 1)
+      kernel.reset (new MultiImageKernel (header, ops));
+    else switch (op) {
       case 0:  kernel.reset (new ImageKernel<Mean>    (header)); break;
       case 1:  kernel.reset (new ImageKernel<Median>  (header)); break;
       case 2:  kernel.reset (new ImageKernel<Sum>     (header)); break;
@@ -446,7 +611,7 @@ void run ()
 
     // Feed the input images to the kernel one at a time
     {
-      ProgressBar progress (std::string("computing ") + operations[op] + " across "
+      ProgressBar progress (std::string("computing ") + operation_names + " across "
           + str(headers_in.size()) + " images", num_inputs);
       for (size_t i = 0; i != headers_in.size(); ++i) {
         assert (headers_in[i].valid());
@@ -456,7 +621,9 @@ void run ()
       }
     }
 
-    auto out = Header::create (output_path, header).get_image<value_type>();
+    vector<Image<value_type>> out;
+    for (const auto& path : output_paths)
+      out.push_back (Header::create (path, header).get_image<value_type>());
     kernel->write_back (out);
   }
 
@@ -641,6 +641,15 @@ void run ()
     nl_registration.set_init_grad_step (opt[0][0]);
   }
 
+  opt = get_options ("nl_velocity");
+  if (opt.size()) {
+    if (!do_nonlinear)
+      throw Exception ("velocity field parametrisation was requested when no non-linear registration is requested");
+    if (nonlinear_init)
+      throw Exception ("the -nl_velocity option cannot be used when initialising with non-linear warps");
+    nl_registration.set_velocity_field (true);
+  }
+
   opt = get_options ("nl_lmax");
   vector<int> nl_lmax;
   if (opt.size ()) {
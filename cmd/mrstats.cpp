@@ -25,6 +25,7 @@
 
 #include "algo/histogram.h"
 #include "algo/loop.h"
+#include "algo/threaded_loop.h"
 #include "file/ofstream.h"
 
 
@@ -95,17 +96,48 @@ class Volume_loop
 
 
 
-void run_volume (Stats::Stats& stats, Image<complex_type>& data, Image<bool>& mask)
-{
-  if (mask.valid()) {
-    for (auto l = Loop(0,3) (data, mask); l; ++l) {
+// accumulates statistics for each thread separately, and merges them into
+// the overall statistics on destruction:
+class StatsKernel
+{ NOMEMALIGN
+  public:
+    StatsKernel (Stats::Stats& overall, std::mutex& mutex, const bool is_complex, const bool ignorezero) :
+        overall (overall),
+        mutex (mutex),
+        stats (is_complex, ignorezero) { }
+
+    ~StatsKernel ()
+    {
+      std::lock_guard<std::mutex> lock (mutex);
+      overall += stats;
+    }
+
+    void operator() (Image<complex_type>& data)
+    {
+      stats (data.value());
+    }
+
+    void operator() (Image<complex_type>& data, Image<bool>& mask)
+    {
       if (mask.value())
         stats (data.value());
     }
-  } else {
-    for (auto l = Loop(0,3) (data); l; ++l)
-      stats (data.value());
-  }
+
+  private:
+    Stats::Stats& overall;
+    std::mutex& mutex;
+    Stats::Stats stats;
+};
+
+
+
+void run_volume (Stats::Stats& stats, Image<complex_type>& data, Image<bool>& mask, const bool is_complex, const bool ignorezero)
+{
+  std::mutex mutex;
+  if (mask.valid())
+    ThreadedLoop (data, 0, 3).run (StatsKernel (stats, mutex, is_complex, ignorezero), data, mask);
+  else
+    ThreadedLoop (data, 0, 3).run (StatsKernel (stats, mutex, is_complex, ignorezero), data);
 }
 
 
@@ -140,14 +172,14 @@ void run ()
 
     Stats::Stats stats (is_complex, ignorezero);
     for (auto i = Volume_loop (data); i; ++i)
-      run_volume (stats, data, mask);
+      run_volume (stats, data, mask, is_complex, ignorezero);
     stats.print (data, fields);
 
   } else {
 
     for (auto i = Volume_loop (data); i; ++i) {
       Stats::Stats stats (is_complex, ignorezero);
-      run_volume (stats, data, mask);
+      run_volume (stats, data, mask, is_complex, ignorezero);
       stats.print (data, fields);
     }
 
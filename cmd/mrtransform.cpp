@@ -23,6 +23,7 @@
 #include "interp/cubic.h"
 #include "interp/sinc.h"
 #include "filter/reslice.h"
+#include "filter/resample_operator.h"
 #include "filter/warp.h"
 #include "algo/loop.h"
 #include "algo/copy.h"
@@ -161,6 +162,21 @@ void usage ()
         "Use -from 1 to warp from image1 or -from 2 to warp from image2")
     +   Argument ("image").type_integer (1,2)
 
+    + OptionGroup ("Precomputed resampling options")
+
+    + Option ("export_operator",
+        "save the resampling operator (i.e. the interpolation weights of every output voxel) computed for this "
+        "transformation to file, so that it can be applied to other images on the same grid using the -operator option. "
+        "Only the nearest, linear and cubic interpolators are supported.")
+    + Argument ("file").type_file_out()
+
+    + Option ("operator",
+        "resample the input image using a resampling operator previously saved with the -export_operator option, "
+        "rather than by computing the transformation. The input image must be defined on the same grid as the image used "
+        "to compute the operator; the output image will be on its target grid. All volumes are processed in a single pass. "
+        "This option cannot be combined with any other transformation option, and no FOD reorientation is performed.")
+    + Argument ("file").type_file_in()
+
     + OptionGroup ("Fibre orientation distribution handling options")
 
     + Option ("modulate",
@@ -188,8 +204,36 @@ void usage ()
       "Use NaN as the out of bounds value (Default: 0.0)");
 }
 
+Filter::ResampleOperator compute_operator (const Header& input, const Header& output, const transform_type& linear_transform,
+  const int interp, const vector<int>& oversample) {
+  switch (interp) {
+    case 0: return Filter::ResampleOperator::from_transform<Interp::Nearest> (input, output, linear_transform, oversample);
+    case 1: return Filter::ResampleOperator::from_transform<Interp::Linear> (input, output, linear_transform, oversample);
+    case 2: return Filter::ResampleOperator::from_transform<Interp::Cubic> (input, output, linear_transform, oversample);
+    default: throw Exception ("resampling operator can only be computed for nearest, linear or cubic interpolation");
+  }
+}
+
+Filter::ResampleOperator compute_operator (const Header& input, const Header& output, Image<default_type>& warp,
+  const int interp, const vector<int>& oversample) {
+  switch (interp) {
+    case 0: return Filter::ResampleOperator::from_deformation<Interp::Nearest> (input, output, warp, oversample);
+    case 1: return Filter::ResampleOperator::from_deformation<Interp::Linear> (input, output, warp, oversample);
+    case 2: return Filter::ResampleOperator::from_deformation<Interp::Cubic> (input, output, warp, oversample);
+    default: throw Exception ("resampling operator can only be computed for nearest, linear or cubic interpolation");
+  }
+}
+
+
+
 void apply_warp (Image<float>& input, Image<float>& output, Image<default_type>& warp,
-  const int interp, const float out_of_bounds_value, const vector<int>& oversample) {
+  const int interp, const float out_of_bounds_value, const vector<int>& oversample, const std::string& export_operator) {
+  if (export_operator.size()) {
+    auto resample_operator = compute_operator (input, output, warp, interp, oversample);
+    resample_operator.save (export_operator);
+    resample_operator (input, output, out_of_bounds_value);
+    return;
+  }
   switch (interp) {
   case 0:
     Filter::warp<Interp::Nearest> (input, output, warp, out_of_bounds_value, oversample);
@@ -491,6 +535,34 @@ void run ()
       WARN ("Out of bounds value ignored since the input image will not be regridded");
   }
 
+  // Precomputed resampling operator
+  std::string export_operator;
+  opt = get_options ("export_operator");
+  if (opt.size()) {
+    if (!warp && !template_header)
+      throw Exception ("-export_operator option applies only to regridding using the template option or to non-linear transformations");
+    export_operator = std::string (opt[0][0]);
+  }
+
+  opt = get_options ("operator");
+  if (opt.size()) {
+    if (linear || warp.valid() || template_header.valid() || get_options ("midway_space").size())
+      throw Exception ("the -operator option cannot be used in combination with any other transformation option");
+    if (export_operator.size())
+      throw Exception ("the -operator and -export_operator options are mutually exclusive");
+    Filter::ResampleOperator resample_operator (opt[0][0]);
+    if (input_header.ndim() == 4 && input_header.size(3) >= 6 &&
+        input_header.size(3) == (int) Math::SH::NforL (Math::SH::LforN (input_header.size(3))) &&
+        !get_options ("noreorientation").size())
+      WARN ("SH series detected, but no FOD reorientation is performed when applying a precomputed resampling operator");
+    Header operator_header = resample_operator.destination_header (output_header);
+    add_line (operator_header.keyval()["comments"], std::string ("resampled using operator \"" + std::string (opt[0][0]) + "\""));
+    auto input = input_header.get_image<float>();
+    auto output = Image<float>::create (argument[1], operator_header);
+    resample_operator (input, output, out_of_bounds_value);
+    return;
+  }
+
   auto input = input_header.get_image<float>().with_direct_io (stride);
 
   // Reslice the image onto template
@@ -517,7 +589,11 @@ void run ()
       output_header.datatype() = DataType::from_command_line (input_header.datatype());
     auto output = Image<float>::create (argument[1], output_header).with_direct_io();
 
-    switch (interp) {
+    if (export_operator.size()) {
+      auto resample_operator = compute_operator (input, output, linear_transform, interp, oversample);
+      resample_operator.save (export_operator);
+      resample_operator (input, output, out_of_bounds_value);
+    } else switch (interp) {
       case 0:
         Filter::reslice<Interp::Nearest> (input, output, linear_transform, oversample, out_of_bounds_value);
         break;
@@ -564,7 +640,7 @@ void run ()
       } else {
         warp_deform = Registration::Warp::compute_full_deformation (warp, template_header, from);
       }
-      apply_warp (input, output, warp_deform, interp, out_of_bounds_value, oversample);
+      apply_warp (input, output, warp_deform, interp, out_of_bounds_value, oversample, export_operator);
       if (fod_reorientation)
         Registration::Transform::reorient_warp ("reorienting", output, warp_deform, directions_cartesian.transpose(), modulate);
 
@@ -572,13 +648,13 @@ void run ()
     } else if (warp.ndim() == 4 && linear) {
       auto warp_composed = Image<default_type>::scratch (warp);
       Registration::Warp::compose_linear_deformation (linear_transform, warp, warp_composed);
-      apply_warp (input, output, warp_composed, interp, out_of_bounds_value, oversample);
+      apply_warp (input, output, warp_composed, interp, out_of_bounds_value, oversample, export_operator);
       if (fod_reorientation)
         Registration::Transform::reorient_warp ("reorienting", output, warp_composed, directions_cartesian.transpose(), modulate);
 
     // Apply 4D deformation field only
     } else {
-      apply_warp (input, output, warp, interp, out_of_bounds_value, oversample);
+      apply_warp (input, output, warp, interp, out_of_bounds_value, oversample, export_operator);
       if (fod_reorientation)
         Registration::Transform::reorient_warp ("reorienting", output, warp, directions_cartesian.transpose(), modulate);
     }
@@ -13,6 +13,8 @@
  */
 
 
+#include <array>
+
 #include "command.h"
 #include "math/SH.h"
 #include "memory.h"
@@ -24,6 +26,9 @@
 
 #define DOT_THRESHOLD 0.99
 #define DEFAULT_NPEAKS 3
+// Number of voxels for which the initial peak search iteration from all
+//   seed directions is performed as a single matrix product
+#define VOXELS_PER_BLOCK 64
 
 using namespace MR;
 using namespace App;
@@ -96,10 +101,11 @@ class Direction { MEMALIGN(Direction)
 
 
 
+// A block of voxels: SH coefficients are stored in the columns of data
 class Item { MEMALIGN(Item)
   public:
-    Eigen::VectorXf data;
-    ssize_t pos[3];
+    Eigen::MatrixXf data;
+    vector<std::array<ssize_t,3>> pos;
 };
 
 
@@ -114,29 +120,30 @@ class DataLoader { MEMALIGN(DataLoader)
       loop (Loop("estimating peak directions", 0, 3) (sh)) { }
 
     bool operator() (Item& item) {
-      if (loop) {
-        item.data.resize (sh.size(3));
-        item.pos[0] = sh.index(0);
-        item.pos[1] = sh.index(1);
-        item.pos[2] = sh.index(2);
+      item.data.resize (sh.size(3), VOXELS_PER_BLOCK);
+      item.pos.clear();
+      while (loop && item.pos.size() < VOXELS_PER_BLOCK) {
+        const size_t v = item.pos.size();
+        item.pos.push_back ({ { sh.index(0), sh.index(1), sh.index(2) } });
 
         if (mask) {
           assign_pos_of(sh).to(*mask);
           if (!mask->value()) {
             for (auto l = Loop(3) (sh); l; ++l)
-              item.data[sh.index(3)] = NaN;
+              item.data (sh.index(3), v) = NaN;
           }
         } else {
           // iterates over SH coefficients
           for (auto l = Loop(3) (sh); l; ++l)
-            item.data[sh.index(3)] = sh.value();
+            item.data (sh.index(3), v) = sh.value();
         }
 
         loop++;
-
-        return true;
       }
-      return false;
+      if (item.pos.empty())
+        return false;
+      item.data.conservativeResize (Eigen::NoChange, item.pos.size());
+      return true;
     }
 
   private:
@@ -166,25 +173,55 @@ class Processor { MEMALIGN(Processor)
       threshold (threshold),
       peaks_out (npeaks),
       ipeaks_vox (ipeaks_data),
-      precomputer (use_precomputer ? new Math::SH::PrecomputedAL<value_type> (lmax) :  nullptr) { }
+      precomputer (use_precomputer ? new Math::SH::PrecomputedAL<value_type> (lmax) :  nullptr)
+    {
+      Eigen::Matrix<value_type, Eigen::Dynamic, 3> seed_dirs (dirs.rows(), 3);
+      for (ssize_t i = 0; i != dirs.rows(); ++i) {
+        seeds.push_back (Direction (dirs (i,0), dirs (i,1)));
+        seed_dirs.row(i) = seeds.back().v;
+      }
+      seed_derivatives = std::make_shared<Math::SH::DerivativesTransform<value_type>> (seed_dirs, lmax);
+    }
 
     bool operator() (const Item& item) {
+      // Amplitudes & derivatives at all seed directions, for all voxels in
+      //   the block; these provide the first iteration of each peak search
+      (*seed_derivatives) (derivatives, item.data);
+      for (size_t v = 0; v != item.pos.size(); ++v)
+        process (item.data.col(v), item.pos[v], derivatives.col(v));
+      return true;
+    }
+
+  private:
+    Image<value_type> dirs_vox;
+    Eigen::Matrix<value_type, Eigen::Dynamic, 2> dirs;
+    int lmax, npeaks;
+    vector<Direction> true_peaks;
+    value_type threshold;
+    vector<Direction> peaks_out;
+    copy_ptr<Image<value_type> > ipeaks_vox;
+    Math::SH::PrecomputedAL<value_type>* precomputer;
+    vector<Direction> seeds;
+    std::shared_ptr<Math::SH::DerivativesTransform<value_type>> seed_derivatives;
+    Eigen::MatrixXf derivatives;
 
-      dirs_vox.index(0) = item.pos[0];
-      dirs_vox.index(1) = item.pos[1];
-      dirs_vox.index(2) = item.pos[2];
+    void process (Eigen::Ref<const Eigen::VectorXf> data, const std::array<ssize_t,3>& pos, Eigen::Ref<const Eigen::VectorXf> seed_derivs) {
 
-      if (check_input (item)) {
+      dirs_vox.index(0) = pos[0];
+      dirs_vox.index(1) = pos[1];
+      dirs_vox.index(2) = pos[2];
+
+      if (check_input (data, pos)) {
         for (auto l = Loop(3) (dirs_vox); l; ++l)
           dirs_vox.value() = NaN;
-        return true;
+        return;
       }
 
       vector<Direction> all_peaks;
 
-      for (size_t i = 0; i < size_t(dirs.rows()); i++) {
-        Direction p (dirs (i,0), dirs (i,1));
-        p.a = Math::SH::get_peak (item.data, lmax, p.v, precomputer);
+      for (size_t i = 0; i < seeds.size(); i++) {
+        Direction p (seeds[i]);
+        p.a = Math::SH::get_peak (data, lmax, p.v, precomputer, seed_derivs.data() + 6*i);
         if (std::isfinite (p.a)) {
           for (size_t j = 0; j < all_peaks.size(); j++) {
             if (abs (p.v.dot (all_peaks[j].v)) > DOT_THRESHOLD) {
@@ -198,9 +235,9 @@ class Processor { MEMALIGN(Processor)
       }
 
       if (ipeaks_vox) {
-        ipeaks_vox->index(0) = item.pos[0];
-        ipeaks_vox->index(1) = item.pos[1];
-        ipeaks_vox->index(2) = item.pos[2];
+        ipeaks_vox->index(0) = pos[0];
+        ipeaks_vox->index(1) = pos[1];
+        ipeaks_vox->index(2) = pos[2];
 
         for (int i = 0; i < npeaks; i++) {
           Eigen::Vector3f p;
@@ -246,36 +283,24 @@ class Processor { MEMALIGN(Processor)
         dirs_vox.index(3)++;
       }
       for (; dirs_vox.index(3) < 3*npeaks; dirs_vox.index(3)++) dirs_vox.value() = NaN;
-
-      return true;
     }
 
-  private:
-    Image<value_type> dirs_vox;
-    Eigen::Matrix<value_type, Eigen::Dynamic, 2> dirs;
-    int lmax, npeaks;
-    vector<Direction> true_peaks;
-    value_type threshold;
-    vector<Direction> peaks_out;
-    copy_ptr<Image<value_type> > ipeaks_vox;
-    Math::SH::PrecomputedAL<value_type>* precomputer;
-
-    bool check_input (const Item& item) {
+    bool check_input (Eigen::Ref<const Eigen::VectorXf> data, const std::array<ssize_t,3>& pos) {
       if (ipeaks_vox) {
-        ipeaks_vox->index(0) = item.pos[0];
-        ipeaks_vox->index(1) = item.pos[1];
-        ipeaks_vox->index(2) = item.pos[2];
+        ipeaks_vox->index(0) = pos[0];
+        ipeaks_vox->index(1) = pos[1];
+        ipeaks_vox->index(2) = pos[2];
         ipeaks_vox->index(3) = 0;
         if (std::isnan (value_type (ipeaks_vox->value())))
           return true;
       }
 
       bool no_peaks = true;
-      for (size_t i = 0; i < size_t(item.data.size()); i++) {
-        if (std::isnan (item.data[i]))
+      for (size_t i = 0; i < size_t(data.size()); i++) {
+        if (std::isnan (data[i]))
           return true;
         if (no_peaks)
-          if (i && item.data[i] != 0.0)
+          if (i && data[i] != 0.0)
             no_peaks = false;
       }
 
@@ -343,7 +368,7 @@ void run ()
   Processor processor (peaks, dirs, Math::SH::LforN (SH_data.size (3)),
       npeaks, true_peaks, threshold, ipeaks_data.get(), get_options("fast").size());
 
-  Thread::run_queue (loader, Thread::batch (Item()), Thread::multi (processor));
+  Thread::run_queue (loader, Item(), Thread::multi (processor));
 }
 
 
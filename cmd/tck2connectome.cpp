@@ -24,6 +24,7 @@
 #include "dwi/tractography/properties.h"
 #include "dwi/tractography/weights.h"
 #include "dwi/tractography/mapping/loader.h"
+#include "dwi/tractography/connectome/assignments.h"
 #include "dwi/tractography/connectome/connectome.h"
 #include "dwi/tractography/connectome/metric.h"
 #include "dwi/tractography/connectome/mapper.h"
@@ -70,8 +71,28 @@ void usage ()
                                "this can be used subsequently e.g. by the command connectome2tck")
     + Argument ("path").type_file_out()
 
+  + Option ("out_assignments_cache", "output the node assignments of each streamline to a compact binary file, "
+                                     "from which they can be read by a subsequent invocation of tck2connectome "
+                                     "with the same tractogram and parcellation image (using the -in_assignments_cache option)")
+    + Argument ("path").type_file_out()
+
+  + Option ("in_assignments_cache", "read the node assignments of each streamline from a file generated using the -out_assignments_cache option, "
+                                    "rather than assigning streamlines to nodes; "
+                                    "unless the connectome metric depends on streamline length, or the -additional option is used, "
+                                    "the streamline vertices are then not read at all")
+    + Argument ("path").type_file_in()
+
   + Option ("vector", "output a vector representing connectivities from a given seed point to target nodes, "
-                      "rather than a matrix of node-node connectivities");
+                      "rather than a matrix of node-node connectivities")
+
+  + Option ("additional", "generate an additional connectome from a different node parcellation image, "
+                          "within the same pass through the tractogram; "
+                          "only the parcellation differs between outputs: the assignment mechanism, metric and edge statistic "
+                          "are those used for the primary output, so connectomes based on different metrics still require "
+                          "separate invocations; streamline assignments (-out_assignments option) are only written for the "
+                          "primary parcellation (option can be used multiple times)").allow_multiple()
+    + Argument ("nodes_in").type_image_in()
+    + Argument ("connectome_out").type_file_out();
 
   REFERENCES
   + "If using the default streamline-parcel assignment mechanism (or -assignment_radial_search option): " // Internal
@@ -88,96 +109,228 @@ void usage ()
 
 
 
+// Everything relating to one of the parcellation images being processed
+class Parcellation
+{ MEMALIGN(Parcellation)
+  public:
+    Parcellation (const std::string& nodes_path, const std::string& output_path) :
+        nodes (Image<node_t>::open (nodes_path)),
+        output_path (output_path),
+        max_node_index (0)
+    {
+      // First, find out how many segmented nodes there are, so the matrix can be pre-allocated
+      // Also check for node volume for all nodes
+      vector<uint32_t> node_volumes (1, 0);
+      for (auto i = Loop (nodes) (nodes); i; ++i) {
+        if (nodes.value() > max_node_index) {
+          max_node_index = nodes.value();
+          node_volumes.resize (max_node_index + 1, 0);
+        }
+        ++node_volumes[nodes.value()];
+      }
+
+      for (size_t i = 1; i != node_volumes.size(); ++i) {
+        if (!node_volumes[i])
+          missing_nodes.insert (i);
+      }
+      if (missing_nodes.size()) {
+        WARN ("The following nodes are missing from the parcellation image \"" + nodes.name() + "\":");
+        std::set<node_t>::iterator i = missing_nodes.begin();
+        std::string list = str(*i);
+        for (++i; i != missing_nodes.end(); ++i)
+          list += ", " + str(*i);
+        WARN (list);
+        WARN ("(This may indicate poor parcellation image preparation, use of incorrect or incomplete LUT file(s) in labelconvert, or very poor registration)");
+      }
+    }
+
+    Image<node_t> nodes;
+    const std::string output_path;
+    node_t max_node_index;
+    std::set<node_t> missing_nodes;
+};
+
+
+
+// Verify that streamline assignments read from file were generated using the
+//   same data & assignment mechanism as requested
+void check_cache (const AssignmentsCache& cache, Tractography::Properties& properties, const Parcellation& parcellation)
+{
+  bool mode_specified = false;
+  for (size_t index = 0; modes[index]; ++index) {
+    if (get_options (modes[index]).size())
+      mode_specified = true;
+  }
+  if (mode_specified && assignment_mode_description() != cache.info().assignment)
+    throw Exception ("Streamline assignments file \"" + cache.name() + "\" was generated using a different assignment mechanism (" + cache.info().assignment + ")");
+  if (properties["count"].size() && to<size_t> (properties["count"]) != cache.size())
+    throw Exception ("Streamline assignments file \"" + cache.name() + "\" contains " + str(cache.size()) + " entries; track file contains " + properties["count"] + " tracks");
+  if (cache.info().timestamp.size() && properties["timestamp"].size() && cache.info().timestamp != properties["timestamp"])
+    throw Exception ("Streamline assignments file \"" + cache.name() + "\" was not generated from track file \"" + std::string (argument[0]) + "\"");
+  AssignmentsCache::Info current;
+  current.set_parcellation (parcellation.nodes);
+  if (!cache.info().same_parcellation (current))
+    throw Exception ("Streamline assignments file \"" + cache.name() + "\" was not generated from parcellation image \"" + parcellation.nodes.name() + "\"");
+  INFO ("Using streamline assignments from file \"" + cache.name() + "\" (assignment mechanism: " + cache.info().assignment + ")");
+}
+
+
+
+template <typename T>
+void save (Tractography::Connectome::Matrix<T>& connectome, const Parcellation& parcellation)
+{
+  connectome.finalize();
+  connectome.error_check (parcellation.missing_nodes);
+  connectome.save (parcellation.output_path, get_options ("keep_unassigned").size(), get_options ("symmetric").size(), get_options ("zero_diagonal").size());
+}
+
+
+
 template <typename T>
-void execute (Image<node_t>& node_image, const node_t max_node_index, const std::set<node_t>& missing_nodes)
+void write_assignments (const Tractography::Connectome::Matrix<T>& connectome, const Parcellation& parcellation, const AssignmentsCache* cache, Tractography::Properties& properties)
+{
+  auto opt = get_options ("out_assignments");
+  if (opt.size())
+    connectome.write_assignments (opt[0][0]);
+
+  opt = get_options ("out_assignments_cache");
+  if (opt.size()) {
+    AssignmentsCache::Info info;
+    info.assignment = cache ? cache->info().assignment : assignment_mode_description();
+    info.timestamp = properties["timestamp"];
+    info.set_parcellation (parcellation.nodes);
+    connectome.write_assignments_cache (opt[0][0], info);
+  }
+}
+
+
+
+void execute (vector<Parcellation>& parcellations)
 {
   // Are we generating a matrix or a vector?
   const bool vector_output = get_options ("vector").size();
 
   // Do we need to keep track of the nodes to which each streamline is
   //   assigned, or would it be a waste of memory?
-  const bool track_assignments = get_options ("out_assignments").size();
-
-  // Get the metric, assignment mechanism & per-edge statistic for connectome construction
-  Metric metric;
-  Tractography::Connectome::setup_metric (metric, node_image);
-  std::unique_ptr<Tck2nodes_base> tck2nodes (load_assignment_mode (node_image));
-  auto opt = get_options ("stat_edge");
-  const stat_edge statistic = opt.size() ? stat_edge(int(opt[0][0])) : stat_edge::SUM;
+  const bool track_assignments = get_options ("out_assignments").size() || get_options ("out_assignments_cache").size();
 
   // Prepare for reading the track data
   Tractography::Properties properties;
   Tractography::Reader<float> reader (argument[0], properties);
 
+  // Streamline assignments to the primary parcellation may instead have been
+  //   computed previously
+  std::unique_ptr<AssignmentsCache> cache;
+  auto opt = get_options ("in_assignments_cache");
+  if (opt.size()) {
+    cache.reset (new AssignmentsCache (opt[0][0]));
+    check_cache (*cache, properties, parcellations[0]);
+  }
+
+  // Get the metric, assignment mechanism & per-edge statistic for connectome construction
+  // Only node volumes differ in the metric between parcellations, so any
+  //   per-streamline data only need to be loaded once
+  vector<Metric> metrics (1);
+  Tractography::Connectome::setup_metric (metrics[0], parcellations[0].nodes);
+  for (size_t i = 1; i != parcellations.size(); ++i) {
+    metrics.push_back (metrics[0]);
+    if (get_options ("scale_invnodevol").size())
+      metrics.back().set_scale_invnodevol (parcellations[i].nodes);
+  }
+  vector<std::unique_ptr<Tck2nodes_base>> tck2nodes;
+  for (size_t i = 0; i != parcellations.size(); ++i) {
+    if (cache && !i)
+      tck2nodes.emplace_back (new Tck2nodes_cached (parcellations[i].nodes, *cache));
+    else
+      tck2nodes.emplace_back (load_assignment_mode (parcellations[i].nodes));
+  }
+  opt = get_options ("stat_edge");
+  const stat_edge statistic = opt.size() ? stat_edge(int(opt[0][0])) : stat_edge::SUM;
+
   // Initialise classes in preparation for multi-threading
-  Mapping::TrackLoader loader (reader, properties["count"].empty() ? 0 : to<size_t>(properties["count"]), "Constructing connectome");
-  Tractography::Connectome::Mapper mapper (*tck2nodes, metric);
-  Tractography::Connectome::Matrix<T> connectome (max_node_index, statistic, vector_output, track_assignments);
+  const std::string message ("Constructing connectome" + std::string (parcellations.size() > 1 ? "s" : ""));
+  vector<Tractography::Connectome::Mapper> mappers;
+  // Each connectome is stored in double precision, unless it has so many
+  //   nodes that RAM usage becomes a concern
+  vector<std::unique_ptr<Tractography::Connectome::Matrix<float>>> float_connectomes;
+  vector<std::unique_ptr<Tractography::Connectome::Matrix<double>>> double_connectomes;
+  vector<Tractography::Connectome::Matrix<float>*> float_connectome_ptrs;
+  vector<Tractography::Connectome::Matrix<double>*> double_connectome_ptrs;
+  for (size_t i = 0; i != parcellations.size(); ++i) {
+    mappers.push_back (Tractography::Connectome::Mapper (*tck2nodes[i], metrics[i]));
+    // Streamline assignments are only written for the primary parcellation
+    const bool assignments = track_assignments && !i;
+    if (parcellations[i].max_node_index >= node_count_ram_limit) {
+      INFO ("Very large number of nodes detected in parcellation image \"" + parcellations[i].nodes.name() + "\"; using single-precision floating-point storage");
+      float_connectomes.emplace_back (new Tractography::Connectome::Matrix<float> (parcellations[i].max_node_index, statistic, vector_output, assignments));
+      double_connectomes.emplace_back();
+    } else {
+      float_connectomes.emplace_back();
+      double_connectomes.emplace_back (new Tractography::Connectome::Matrix<double> (parcellations[i].max_node_index, statistic, vector_output, assignments));
+    }
+    float_connectome_ptrs.push_back (float_connectomes.back().get());
+    double_connectome_ptrs.push_back (double_connectomes.back().get());
+  }
 
-  // Multi-threaded connectome construction
-  if (tck2nodes->provides_pair()) {
+  // Multi-threaded connectome construction:
+  //   the tractogram is read once, and each thread assigns each streamline to
+  //   the nodes of all parcellations
+  Tractography::Connectome::MatrixWorker worker (mappers, float_connectome_ptrs, double_connectome_ptrs);
+  if (!cache || parcellations.size() > 1 || metrics[0].requires_geometry()) {
+    Mapping::TrackLoader loader (reader, properties["count"].empty() ? 0 : to<size_t>(properties["count"]), message);
     Thread::run_queue (
         loader,
         Thread::batch (Tractography::Streamline<float>()),
-        Thread::multi (mapper),
-        Thread::batch (Mapped_track_nodepair()),
-        connectome);
+        Thread::multi (worker));
   } else {
+    // Streamline vertices are not required: only provide the index & weight of each streamline
+    Eigen::VectorXf weights;
+    opt = get_options ("tck_weights_in");
+    if (opt.size()) {
+      weights = load_vector<float> (opt[0][0]);
+      if (size_t(weights.size()) != cache->size())
+        throw Exception ("Streamline weights file contains " + str(weights.size()) + " entries; tractogram contains " + str(cache->size()) + " streamlines");
+    }
+    ProgressBar progress (message, cache->size());
+    size_t index = 0;
+    auto loader = [&] (Tractography::Streamline<float>& out) {
+      if (index == cache->size())
+        return false;
+      out.clear();
+      out.index = index;
+      out.weight = weights.size() ? weights[index] : 1.0f;
+      ++index;
+      ++progress;
+      return true;
+    };
     Thread::run_queue (
         loader,
         Thread::batch (Tractography::Streamline<float>()),
-        Thread::multi (mapper),
-        Thread::batch (Mapped_track_nodelist()),
-        connectome);
+        Thread::multi (worker));
   }
 
-  connectome.finalize();
-  connectome.error_check (missing_nodes);
-
-  connectome.save (argument[2], get_options ("keep_unassigned").size(), get_options ("symmetric").size(), get_options ("zero_diagonal").size());
+  for (size_t i = 0; i != parcellations.size(); ++i) {
+    if (float_connectomes[i])
+      save (*float_connectomes[i], parcellations[i]);
+    else
+      save (*double_connectomes[i], parcellations[i]);
+  }
 
-  opt = get_options ("out_assignments");
-  if (opt.size())
-    connectome.write_assignments (opt[0][0]);
+  if (float_connectomes[0])
+    write_assignments (*float_connectomes[0], parcellations[0], cache.get(), properties);
+  else
+    write_assignments (*double_connectomes[0], parcellations[0], cache.get(), properties);
 }
 
 
 
 void run ()
 {
-  auto node_image = Image<node_t>::open (argument[1]);
-
-  // First, find out how many segmented nodes there are, so the matrix can be pre-allocated
-  // Also check for node volume for all nodes
-  vector<uint32_t> node_volumes (1, 0);
-  node_t max_node_index = 0;
-  for (auto i = Loop (node_image) (node_image); i; ++i) {
-    if (node_image.value() > max_node_index) {
-      max_node_index = node_image.value();
-      node_volumes.resize (max_node_index + 1, 0);
-    }
-    ++node_volumes[node_image.value()];
-  }
+  vector<Parcellation> parcellations;
+  parcellations.push_back (Parcellation (argument[1], argument[2]));
+  auto opt = get_options ("additional");
+  for (size_t i = 0; i != opt.size(); ++i)
+    parcellations.push_back (Parcellation (opt[i][0], opt[i][1]));
 
-  std::set<node_t> missing_nodes;
-  for (size_t i = 1; i != node_volumes.size(); ++i) {
-    if (!node_volumes[i])
-      missing_nodes.insert (i);
-  }
-  if (missing_nodes.size()) {
-    WARN ("The following nodes are missing from the parcellation image:");
-    std::set<node_t>::iterator i = missing_nodes.begin();
-    std::string list = str(*i);
-    for (++i; i != missing_nodes.end(); ++i)
-      list += ", " + str(*i);
-    WARN (list);
-    WARN ("(This may indicate poor parcellation image preparation, use of incorrect or incomplete LUT file(s) in labelconvert, or very poor registration)");
-  }
-
-  if (max_node_index >= node_count_ram_limit) {
-    INFO ("Very large number of nodes detected; using single-precision floating-point storage");
-    execute<float> (node_image, max_node_index, missing_nodes);
-  } else {
-    execute<double> (node_image, max_node_index, missing_nodes);
-  }
+  execute (parcellations);
 }
@@ -46,8 +46,25 @@ class TrackProcessor { MEMALIGN (TrackProcessor)
      fixel_indexer (fixel_indexer) ,
      fixel_directions (fixel_directions),
      fixel_TDI (fixel_TDI),
+     local_TDI (fixel_TDI.size(), 0),
+     mutex (new std::mutex),
      angular_threshold_dp (std::cos (angular_threshold * (Math::pi/180.0))) { }
 
+   TrackProcessor (const TrackProcessor& that) :
+     fixel_indexer (that.fixel_indexer),
+     fixel_directions (that.fixel_directions),
+     fixel_TDI (that.fixel_TDI),
+     local_TDI (fixel_TDI.size(), 0),
+     mutex (that.mutex),
+     angular_threshold_dp (that.angular_threshold_dp) { }
+
+   // Each thread counts into its own buffer, which is added to the output on destruction
+   ~TrackProcessor () {
+     std::lock_guard<std::mutex> lock (*mutex);
+     for (size_t i = 0; i != fixel_TDI.size(); ++i)
+       fixel_TDI[i] += local_TDI[i];
+   }
+
 
    bool operator () (const SetVoxelDir& in)  {
      // For each voxel tract tangent, assign to a fixel
@@ -72,7 +89,7 @@ class TrackProcessor { MEMALIGN (TrackProcessor)
          }
          if (largest_dp > angular_threshold_dp) {
            tract_fixel_indices.push_back (closest_fixel_index);
-           fixel_TDI[closest_fixel_index]++;
+           local_TDI[closest_fixel_index]++;
          }
        }
      }
@@ -84,6 +101,8 @@ class TrackProcessor { MEMALIGN (TrackProcessor)
    Image<uint32_t> fixel_indexer;
    const vector<Eigen::Vector3>& fixel_directions;
    vector<uint16_t>& fixel_TDI;
+   vector<uint16_t> local_TDI;
+   std::shared_ptr<std::mutex> mutex;
    const float angular_threshold_dp;
 };
 
@@ -172,9 +191,9 @@ void run ()
     Thread::run_queue (
         loader,
         Thread::batch (DWI::Tractography::Streamline<float>()),
-        mapper,
+        Thread::multi (mapper),
         Thread::batch (SetVoxelDir()),
-        tract_processor);
+        Thread::multi (tract_processor));
   }
   track_file.close();
 
@@ -374,7 +374,7 @@ void run ()
     mapper.set_upsample_ratio (upsample_ratio);
     mapper.add_twdfc_static_image (fmri_image);
     Mapping::MapWriter<float> writer (header, argument[2], stat_vox);
-    Thread::run_queue (loader, Thread::batch (Tractography::Streamline<>()), Thread::multi (mapper), Thread::batch (Mapping::SetVoxel()), writer);
+    Mapping::run_queue (loader, Tractography::Streamline<>(), mapper, Mapping::SetVoxel(), writer);
     writer.finalise();
 
   } else {
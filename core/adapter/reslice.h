@@ -201,6 +201,40 @@ namespace MR
           return interp.value();
         }
 
+        using ImageBase<Reslice<Interpolator,ImageType>,value_type>::row;
+
+        //! read the interpolated values of all volumes along \a axis at the current position
+        /*! This is equivalent to reading value() for each volume in turn, but
+         * the interpolation weights need only be computed once per (sub-)voxel
+         * position, rather than once per volume. */
+        void row (Eigen::Matrix<value_type, Eigen::Dynamic, 1>& values, size_t axis) {
+          using namespace Eigen;
+          if (oversampling) {
+            row_sum.setZero (interp.size (axis));
+            Vector3 d (x[0]+from[0], x[1]+from[1], x[2]+from[2]);
+            Vector3 s;
+            for (int z = 0; z < OS[2]; ++z) {
+              s[2] = d[2] + z*inc[2];
+              for (int y = 0; y < OS[1]; ++y) {
+                s[1] = d[1] + y*inc[1];
+                for (int x = 0; x < OS[0]; ++x) {
+                  s[0] = d[0] + x*inc[0];
+                  if (interp.voxel (direct_transform * s)) {
+                    interp.row (row_sample, axis);
+                    row_sum += row_sample.template cast<default_type>();
+                  }
+                }
+              }
+            }
+            values.resize (row_sum.size());
+            for (ssize_t n = 0; n < row_sum.size(); ++n)
+              values[n] = normalise<value_type> (row_sum[n], norm);
+            return;
+          }
+          interp.voxel (direct_transform * Vector3 (x[0], x[1], x[2]));
+          interp.row (values, axis);
+        }
+
         ssize_t get_index (size_t axis) const { return axis < 3 ? x[axis] : interp.index(axis); }
         void move_index (size_t axis, ssize_t increment) {
           if (axis < 3) x[axis] += increment;
@@ -217,6 +251,8 @@ namespace MR
         default_type from[3], inc[3];
         default_type norm;
         const transform_type transform_, direct_transform;
+        Eigen::Matrix<value_type, Eigen::Dynamic, 1> row_sample;
+        Eigen::Matrix<default_type, Eigen::Dynamic, 1> row_sum;
 
     };
 
@@ -21,6 +21,8 @@
 namespace MR
 {
 
+  template <typename ValueType> class Image;
+
   //! \cond skip
   namespace {
 
@@ -31,6 +33,96 @@ namespace MR
         }
     };
 
+
+
+    // access to a whole row of values along an axis, in bulk where
+    // supported by the image type (i.e. for Image<ValueType>):
+    template <class ImageType>
+      FORCE_INLINE void __get_row (ImageType& image, size_t axis, typename ImageType::value_type* values, size_t count) {
+        for (size_t n = 0; n < count; ++n, ++image.index (axis))
+          values[n] = image.value();
+        image.index (axis) -= count;
+      }
+
+    template <class ImageType>
+      FORCE_INLINE void __set_row (ImageType& image, size_t axis, const typename ImageType::value_type* values, size_t count) {
+        for (size_t n = 0; n < count; ++n, ++image.index (axis))
+          image.value() = values[n];
+        image.index (axis) -= count;
+      }
+
+    template <typename ValueType>
+      FORCE_INLINE void __get_row (Image<ValueType>& image, size_t axis, ValueType* values, size_t count) {
+        image.get_values (axis, values, count);
+      }
+
+    template <typename ValueType>
+      FORCE_INLINE void __set_row (Image<ValueType>& image, size_t axis, const ValueType* values, size_t count) {
+        image.set_values (axis, values, count);
+      }
+
+    template <class ImageType> struct __has_bulk_row_access : std::false_type { NOMEMALIGN };
+    template <typename ValueType> struct __has_bulk_row_access<Image<ValueType>> : std::true_type { NOMEMALIGN };
+
+    // not used for bool, since the row buffer (vector<bool>) has no data():
+    template <class InputImageType, class OutputImageType>
+      struct __use_row_copy : std::integral_constant<bool,
+          std::is_same<typename InputImageType::value_type, typename OutputImageType::value_type>::value &&
+          !std::is_same<typename InputImageType::value_type, bool>::value &&
+          ( __has_bulk_row_access<InputImageType>::value || __has_bulk_row_access<OutputImageType>::value )> { NOMEMALIGN };
+
+
+
+    // copy row by row along the innermost axis, used if either image
+    // supports bulk row access (avoiding per-voxel type conversion):
+    template <class InputImageType, class OutputImageType>
+      struct __copy_row_func { MEMALIGN(__copy_row_func<InputImageType,OutputImageType>)
+        __copy_row_func (const InputImageType& in, const OutputImageType& out, const vector<size_t>& outer_axes, const vector<size_t>& inner_axes) :
+          in (in), out (out), outer_axes (outer_axes), axis (inner_axes[0]), row_loop_axes (inner_axes.begin()+1, inner_axes.end()) { }
+
+        // only the outer axes are assigned, so that any position already set
+        // by the caller along axes not being looped over is preserved:
+        void operator() (const Iterator& pos) {
+          assign_pos_of (pos, outer_axes).to (in, out);
+          if (row_loop_axes.empty())
+            copy_row();
+          else {
+            for (auto l = Loop (row_loop_axes) (in, out); l; ++l)
+              copy_row();
+          }
+        }
+
+        FORCE_INLINE void copy_row () {
+          values.resize (in.size (axis));
+          __get_row (in, axis, values.data(), values.size());
+          __set_row (out, axis, values.data(), values.size());
+        }
+
+        InputImageType in;
+        OutputImageType out;
+        const vector<size_t> outer_axes;
+        const size_t axis;
+        const vector<size_t> row_loop_axes;
+        vector<typename InputImageType::value_type> values;
+      };
+
+
+
+    template <class LoopType, class InputImageType, class OutputImageType>
+      inline typename std::enable_if<__use_row_copy<InputImageType,OutputImageType>::value, void>::type
+      __run_copy (LoopType&& loop, InputImageType& source, OutputImageType& destination)
+      {
+        loop.run_outer (__copy_row_func<InputImageType,OutputImageType> (source, destination, loop.outer_loop.axes, loop.inner_axes));
+        check_app_exit_code();
+      }
+
+    template <class LoopType, class InputImageType, class OutputImageType>
+      inline typename std::enable_if<!__use_row_copy<InputImageType,OutputImageType>::value, void>::type
+      __run_copy (LoopType&& loop, InputImageType& source, OutputImageType& destination)
+      {
+        loop.run (__copy_func(), source, destination);
+      }
+
   }
 
   //! \endcond
@@ -45,8 +137,7 @@ namespace MR
         const vector<size_t>& axes,
         size_t num_axes_in_thread = 1) 
     {
-      ThreadedLoop (source, axes, num_axes_in_thread)
-        .run (__copy_func(), source, destination);
+      __run_copy (ThreadedLoop (source, axes, num_axes_in_thread), source, destination);
     }
 
   template <class InputImageType, class OutputImageType>
@@ -57,8 +148,7 @@ namespace MR
         size_t to_axis = std::numeric_limits<size_t>::max(),
         size_t num_axes_in_thread = 1)
     {
-      ThreadedLoop (source, from_axis, to_axis, num_axes_in_thread)
-        .run (__copy_func(), source, destination);
+      __run_copy (ThreadedLoop (source, from_axis, to_axis, num_axes_in_thread), source, destination);
     }
 
 
@@ -72,8 +162,7 @@ namespace MR
         const vector<size_t>& axes,
         size_t num_axes_in_thread = 1)
     {
-      ThreadedLoop (message, source, axes, num_axes_in_thread)
-        .run (__copy_func(), source, destination);
+      __run_copy (ThreadedLoop (message, source, axes, num_axes_in_thread), source, destination);
     }
 
   template <class InputImageType, class OutputImageType>
@@ -85,8 +174,7 @@ namespace MR
         size_t to_axis = std::numeric_limits<size_t>::max(), 
         size_t num_axes_in_thread = 1)
     {
-      ThreadedLoop (message, source, from_axis, to_axis, num_axes_in_thread)
-        .run (__copy_func(), source, destination);
+      __run_copy (ThreadedLoop (message, source, from_axis, to_axis, num_axes_in_thread), source, destination);
     }
 
 
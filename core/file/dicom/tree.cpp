@@ -13,6 +13,14 @@
  */
 
 
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+#include "thread_queue.h"
+#include "file/config.h"
+#include "file/ofstream.h"
 #include "file/path.h"
 #include "file/dicom/element.h"
 #include "file/dicom/quick_scan.h"
@@ -53,7 +61,178 @@ namespace MR {
 
 
 
-      void Tree::read_dir (const std::string& filename, ProgressBar& progress)
+      namespace {
+
+        enum class ScanStatus : int { Unscanned = 0, Valid = 1, Unreadable = 2, NoImageData = 3 };
+
+        class ScanEntry { NOMEMALIGN
+          public:
+            ScanEntry () : size (0), mtime (0), status (ScanStatus::Unscanned) { }
+            std::string filename;
+            int64_t size, mtime;
+            ScanStatus status;
+            QuickScan reader;
+        };
+
+
+
+        const char* scan_cache_first_line = "mrtrix DICOM scan cache 1";
+
+
+        std::string absolute_path (const std::string& path)
+        {
+#ifdef MRTRIX_WINDOWS
+          char* resolved = _fullpath (nullptr, path.c_str(), 0);
+#else
+          char* resolved = realpath (path.c_str(), nullptr);
+#endif
+          if (!resolved)
+            return path;
+          std::string ret (resolved);
+          free (resolved);
+          return ret;
+        }
+
+
+        //CONF option: DICOMScanCache
+        //CONF default: `` (disabled)
+        //CONF The folder in which to store the results of scanning DICOM
+        //CONF folders. When set, the header information gathered from each
+        //CONF DICOM file is stored in a cache file specific to the folder
+        //CONF being scanned, and reused on subsequent scans of the same folder
+        //CONF for all files whose size and modification time are unchanged.
+        //CONF This can considerably speed up repeated access to large DICOM
+        //CONF folders, particularly over networked file systems.
+        std::string scan_cache_filename (const std::string& folder)
+        {
+          const std::string cache_dir = File::Config::get ("DICOMScanCache");
+          if (cache_dir.empty())
+            return std::string();
+          return Path::join (cache_dir, "dicom-scan-" + str (std::hash<std::string>() (absolute_path (folder))) + ".txt");
+        }
+
+
+
+        void write_string (std::ostream& out, const std::string& s)
+        {
+          out << s.size() << " " << s << "\n";
+        }
+
+        std::string read_string (std::istream& in)
+        {
+          size_t size;
+          in >> size;
+          in.get();
+          std::string s (size, '\0');
+          in.read (&s[0], size);
+          in.get();
+          return s;
+        }
+
+
+
+        void read_scan_cache (const std::string& cache_file, std::map<std::string, ScanEntry>& cache)
+        {
+          if (cache_file.empty() || !Path::is_file (cache_file))
+            return;
+
+          std::ifstream in (cache_file, std::ios::in | std::ios::binary);
+          std::string first_line;
+          std::getline (in, first_line);
+          if (first_line != scan_cache_first_line) {
+            INFO ("ignoring DICOM scan cache \"" + cache_file + "\" with unknown format");
+            return;
+          }
+
+          size_t num_entries;
+          in >> num_entries;
+          for (size_t n = 0; n < num_entries && in.good(); ++n) {
+            ScanEntry entry;
+            entry.filename = read_string (in);
+            int status;
+            in >> entry.size >> entry.mtime >> status;
+            entry.status = ScanStatus (status);
+            if (entry.status == ScanStatus::Valid) {
+              QuickScan& r (entry.reader);
+              r.filename = entry.filename;
+              r.modality = read_string (in);
+              r.patient = read_string (in);
+              r.patient_ID = read_string (in);
+              r.patient_DOB = read_string (in);
+              r.study = read_string (in);
+              r.study_ID = read_string (in);
+              r.study_date = read_string (in);
+              r.study_time = read_string (in);
+              r.series = read_string (in);
+              r.series_date = read_string (in);
+              r.series_time = read_string (in);
+              r.sequence = read_string (in);
+              size_t num_image_types;
+              in >> r.series_number >> r.bits_alloc >> r.dim[0] >> r.dim[1] >> r.data >> r.transfer_syntax_supported >> num_image_types;
+              for (size_t i = 0; i < num_image_types; ++i) {
+                const std::string type = read_string (in);
+                in >> r.image_type[type];
+              }
+            }
+            if (in.good())
+              cache[entry.filename] = std::move (entry);
+          }
+
+          if (!in.good()) {
+            INFO ("DICOM scan cache \"" + cache_file + "\" is truncated - ignored");
+            cache.clear();
+            return;
+          }
+          DEBUG ("loaded " + str(cache.size()) + " entries from DICOM scan cache \"" + cache_file + "\"");
+        }
+
+
+
+        void write_scan_cache (const std::string& cache_file, const vector<ScanEntry>& entries)
+        {
+          const std::string tmp_file = cache_file + ".tmp";
+          try {
+            {
+              File::OFStream out (tmp_file, std::ios::out | std::ios::binary | std::ios::trunc);
+              out << scan_cache_first_line << "\n" << entries.size() << "\n";
+              for (const auto& entry : entries) {
+                write_string (out, entry.filename);
+                out << entry.size << " " << entry.mtime << " " << int (entry.status) << "\n";
+                if (entry.status == ScanStatus::Valid) {
+                  const QuickScan& r (entry.reader);
+                  for (const auto* s : { &r.modality, &r.patient, &r.patient_ID, &r.patient_DOB,
+                                         &r.study, &r.study_ID, &r.study_date, &r.study_time,
+                                         &r.series, &r.series_date, &r.series_time, &r.sequence })
+                    write_string (out, *s);
+                  out << r.series_number << " " << r.bits_alloc << " " << r.dim[0] << " " << r.dim[1] << " "
+                      << r.data << " " << r.transfer_syntax_supported << " " << r.image_type.size() << "\n";
+                  for (const auto& type : r.image_type) {
+                    write_string (out, type.first);
+                    out << type.second << "\n";
+                  }
+                }
+              }
+              if (!out.good())
+                throw Exception ("error writing file \"" + tmp_file + "\": " + strerror (errno));
+            }
+            if (std::rename (tmp_file.c_str(), cache_file.c_str()))
+              throw Exception ("error renaming file \"" + tmp_file + "\": " + strerror (errno));
+            DEBUG ("DICOM scan cache \"" + cache_file + "\" updated");
+          }
+          catch (Exception& E) {
+            WARN ("unable to update DICOM scan cache \"" + cache_file + "\": " + E[E.num()-1]);
+            std::remove (tmp_file.c_str());
+          }
+        }
+
+      }
+
+
+
+
+
+
+      void Tree::read_dir (const std::string& filename, vector<std::string>& files, ProgressBar& progress)
       {
         try {
           Path::Dir folder (filename);
@@ -61,15 +240,9 @@ namespace MR {
           while ((entry = folder.read_name()).size()) {
             std::string name (Path::join (filename, entry));
             if (Path::is_dir (name))
-              read_dir (name, progress);
-            else {
-              try {
-                read_file (name);
-              }
-              catch (Exception& E) {
-                E.display (3);
-              }
-            }
+              read_dir (name, files, progress);
+            else
+              files.push_back (name);
             ++progress;
           }
         }
@@ -82,26 +255,15 @@ namespace MR {
 
 
 
-      void Tree::read_file (const std::string& filename)
+      void Tree::add (const QuickScan& reader)
       {
-        QuickScan reader;
-        if (reader.read (filename)) {
-          INFO ("error reading file \"" + filename + "\" - ignored");
-          return;
-        }
-
-        if (! (reader.dim[0] && reader.dim[1] && reader.bits_alloc && reader.data)) {
-          INFO ("DICOM file \"" + filename + "\" does not seem to contain image data - ignored");
-          return;
-        }
-
         std::shared_ptr<Patient> patient = find (reader.patient, reader.patient_ID, reader.patient_DOB);
         std::shared_ptr<Study> study = patient->find (reader.study, reader.study_ID, reader.study_date, reader.study_time);
         for (const auto& image_type : reader.image_type) {
           std::shared_ptr<Series> series = study->find (reader.series, reader.series_number, image_type.first, reader.modality, reader.series_date, reader.series_time);
 
           std::shared_ptr<Image> image (new Image);
-          image->filename = filename;
+          image->filename = reader.filename;
           image->series = series.get();
           image->sequence_name = reader.sequence;
           image->image_type = image_type.first;
@@ -116,17 +278,89 @@ namespace MR {
 
       void Tree::read (const std::string& filename)
       {
-        ProgressBar progress ("scanning DICOM folder \"" + shorten (filename) + "\"", 0);
-        if (Path::is_dir (filename))
-          read_dir (filename, progress);
-        else {
-          try {
-            read_file (filename);
+        vector<ScanEntry> entries;
+        std::string cache_file;
+        std::map<std::string, ScanEntry> cache;
+
+        {
+          vector<std::string> files;
+          if (Path::is_dir (filename)) {
+            ProgressBar progress ("listing DICOM folder \"" + shorten (filename) + "\"", 0);
+            read_dir (filename, files, progress);
+            cache_file = scan_cache_filename (filename);
+            read_scan_cache (cache_file, cache);
           }
-          catch (Exception) {
+          else
+            files.push_back (filename);
+
+          entries.resize (files.size());
+          for (size_t n = 0; n < files.size(); ++n)
+            entries[n].filename = std::move (files[n]);
+        }
+
+        std::atomic<size_t> num_scanned (0);
+        {
+          std::mutex mutex;
+          ProgressBar progress ("scanning DICOM folder \"" + shorten (filename) + "\"", entries.size());
+          size_t next = 0;
+          auto loader = [&] (size_t& index) { index = next++; return index < entries.size(); };
+
+          auto worker = [&] (const size_t& index)
+          {
+            ScanEntry& entry (entries[index]);
+            struct stat buf;
+            if (!stat (entry.filename.c_str(), &buf)) {
+              entry.size = buf.st_size;
+              entry.mtime = buf.st_mtime;
+            }
+
+            const auto cached = cache.find (entry.filename);
+            if (cached != cache.end() && cached->second.size == entry.size && cached->second.mtime == entry.mtime) {
+              entry.status = cached->second.status;
+              entry.reader = cached->second.reader;
+            }
+            else {
+              try {
+                if (entry.reader.read (entry.filename))
+                  entry.status = ScanStatus::Unreadable;
+                else if (! (entry.reader.dim[0] && entry.reader.dim[1] && entry.reader.bits_alloc && entry.reader.data))
+                  entry.status = ScanStatus::NoImageData;
+                else
+                  entry.status = ScanStatus::Valid;
+              }
+              catch (Exception& E) {
+                E.display (3);
+                entry.status = ScanStatus::Unreadable;
+              }
+              ++num_scanned;
+            }
+
+            std::lock_guard<std::mutex> lock (mutex);
+            ++progress;
+            return true;
+          };
+
+          Thread::run_queue (loader, size_t(), Thread::multi (worker));
+        }
+
+        // merge serially in file order, so that the resulting tree does not
+        // depend on the order in which the threads completed:
+        for (const auto& entry : entries) {
+          switch (entry.status) {
+            case ScanStatus::Valid:
+              add (entry.reader);
+              break;
+            case ScanStatus::NoImageData:
+              INFO ("DICOM file \"" + entry.filename + "\" does not seem to contain image data - ignored");
+              break;
+            default:
+              INFO ("error reading file \"" + entry.filename + "\" - ignored");
           }
         }
 
+        if (cache_file.size() && (num_scanned || cache.size() != entries.size()))
+          write_scan_cache (cache_file, entries);
+
         if (size() > 0)
           return;
 
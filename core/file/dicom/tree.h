@@ -25,6 +25,7 @@ namespace MR {
 
       class Series; 
       class Patient;
+      class QuickScan;
 
       class Tree : public vector<std::shared_ptr<Patient>> { NOMEMALIGN
         public:
@@ -42,8 +43,8 @@ namespace MR {
           }
 
         protected:
-          void read_dir (const std::string& filename, ProgressBar& progress);
-          void read_file (const std::string& filename);
+          void read_dir (const std::string& filename, vector<std::string>& files, ProgressBar& progress);
+          void add (const QuickScan& reader);
       }; 
 
       std::ostream& operator<< (std::ostream& stream, const Tree& item);
@@ -30,7 +30,10 @@
 #include <sys/mman.h>
 #endif
 
+#include <atomic>
+
 #include "app.h"
+#include "thread.h"
 #include "file/ofstream.h"
 #include "file/path.h"
 #include "file/mmap.h"
@@ -43,6 +46,79 @@ namespace MR
   namespace File
   {
 
+#ifndef MRTRIX_WINDOWS
+    namespace {
+
+      // Parallel block preload / flush of a delayed write-back buffer: the
+      // transfer to or from file is split into large blocks, with several
+      // requests in flight concurrently. This avoids serialising one very
+      // large request, which performs poorly on networked filesystems where
+      // each request incurs round-trip latency.
+      // This is NOT asynchronous I/O: run() blocks until the whole transfer
+      // has completed, so loading and writing back are not overlapped with
+      // processing (there is no read-ahead or write-behind). Doing so would
+      // require consumers of the buffer to report which regions they have
+      // accessed, which the Image / MMap interface does not currently do.
+      class ParallelBlockTransfer { NOMEMALIGN
+        public:
+          ParallelBlockTransfer (int fd, uint8_t* data, int64_t offset, int64_t size, bool write) :
+            fd (fd), data (data), offset (offset), size (size), write (write),
+            next (0), error (0) { }
+
+          static constexpr int64_t block_size = 16*1024*1024;
+
+          size_t num_blocks () const { return (size + block_size - 1) / block_size; }
+
+          void execute () {
+            size_t n;
+            while (!error && (n = next++) < num_blocks()) {
+              int64_t pos = n * block_size;
+              int64_t remaining = std::min (block_size, size - pos);
+              while (remaining > 0) {
+                const ssize_t count = write ?
+                  pwrite (fd, data + pos, remaining, offset + pos) :
+                  pread (fd, data + pos, remaining, offset + pos);
+                if (count < 0 && errno == EINTR)
+                  continue;
+                if (count <= 0) {
+                  error = ( count < 0 ? errno : EIO );
+                  return;
+                }
+                pos += count;
+                remaining -= count;
+              }
+            }
+          }
+
+          void run () {
+            const size_t nthreads = std::max (size_t(1), std::min (num_blocks(), Thread::number_of_threads()));
+            if (nthreads > 1) {
+              struct Worker { NOMEMALIGN
+                ParallelBlockTransfer& io;
+                void execute () { io.execute(); }
+              } worker = { *this };
+              Thread::run (Thread::multi (worker, nthreads), "parallel block preload/flush threads").wait();
+            }
+            else
+              execute();
+            if (error) {
+              errno = error;
+              throw Exception (strerror (errno));
+            }
+          }
+
+        private:
+          const int fd;
+          uint8_t* const data;
+          const int64_t offset, size;
+          const bool write;
+          std::atomic<size_t> next;
+          std::atomic<int> error;
+      };
+
+    }
+#endif
+
     MMap::MMap (const Entry& entry, bool readwrite, bool preload, int64_t mapped_size) :
       Entry (entry), addr (NULL), first (NULL), msize (mapped_size), readwrite (readwrite)
     {
@@ -135,6 +211,7 @@ namespace MR
 
           if (preload) {
             CONSOLE ("preloading contents of mapped file \"" + Entry::name + "\"...");
+#ifdef MRTRIX_WINDOWS
             std::ifstream in (Entry::name.c_str(), std::ios::in | std::ios::binary);
             if (!in) 
               throw Exception ("failed to open file \"" + Entry::name + "\": " + strerror (errno));
@@ -142,6 +219,19 @@ namespace MR
             in.read ((char*) first, msize);
             if (!in.good())
               throw Exception ("error preloading contents of file \"" + Entry::name + "\": " + strerror(errno));
+#else
+            const int in = open (Entry::name.c_str(), O_RDONLY);
+            if (in < 0)
+              throw Exception ("failed to open file \"" + Entry::name + "\": " + strerror (errno));
+            try {
+              ParallelBlockTransfer (in, first, start, msize, false).run();
+            }
+            catch (Exception& E) {
+              close (in);
+              throw Exception (E, "error preloading contents of file \"" + Entry::name + "\"");
+            }
+            close (in);
+#endif
           }
           else 
             memset (first, 0, msize);
@@ -202,11 +292,26 @@ namespace MR
         if (readwrite) {
           INFO ("writing back contents of mapped file \"" + Entry::name + "\"...");
           try {
+#ifdef MRTRIX_WINDOWS
             File::OFStream out (Entry::name, std::ios::in | std::ios::out | std::ios::binary);
             out.seekp (start, out.beg);
             out.write ((char*) first, msize);
             if (!out.good())
               throw 1;
+#else
+            const int out = open (Entry::name.c_str(), O_WRONLY);
+            if (out < 0)
+              throw 1;
+            try {
+              ParallelBlockTransfer (out, first, start, msize, true).run();
+            }
+            catch (...) {
+              close (out);
+              throw;
+            }
+            if (close (out))
+              throw 1;
+#endif
           }
           catch (...) {
             FAIL ("error writing back contents of file \"" + Entry::name + "\": " + strerror(errno));
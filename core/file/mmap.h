@@ -40,7 +40,11 @@ namespace MR
          * \e asynchronous, the file is memory-mapped as-is with read-write
          * permissions. Otherwise, a write-back RAM buffer is allocated to
          * store the contents of the file, and written back when the
-         * constructor is invoked. 
+         * constructor is invoked. In this case, data are transferred in large
+         * blocks, with several requests issued concurrently to reduce the
+         * impact of the latency of networked filesystems. The whole transfer
+         * nevertheless completes before the constructor (or destructor)
+         * returns, i.e. it is not overlapped with processing.
          *
          * By default, if the file is mapped using the delayed write-back
          * mechanism, its contents will be preloaded into the RAM buffer. If
@@ -20,6 +20,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#ifndef MRTRIX_WINDOWS
+# include <sys/statvfs.h>
+#endif
 
 #include "debug.h"
 #include "app.h"
@@ -44,6 +47,12 @@ namespace MR
         return c+61;
       }
 
+      // the location explicitly requested by the user, if any:
+      const std::string& user_tmpfile_dir () {
+        static const std::string __user_tmpfile_dir = File::Config::get ("TmpFileDir");
+        return __user_tmpfile_dir;
+      }
+
       //CONF option: TmpFileDir
       //CONF default: `/tmp` (on Unix), `.` (on Windows)
       //CONF The prefix for temporary files (as used in pipelines). By default,
@@ -57,13 +66,13 @@ namespace MR
       //CONF Python scripts construct their temporary directories; that is
       //CONF determined based on config file option :option:`ScriptTmpDir`.
       const std::string& tmpfile_dir () {
-        static const std::string __tmpfile_dir = File::Config::get ("TmpFileDir",
+        static const std::string __tmpfile_dir = user_tmpfile_dir().size() ? user_tmpfile_dir() :
 #ifdef MRTRIX_WINDOWS
             "."
 #else
             "/tmp"
 #endif
-            );
+            ;
         return __tmpfile_dir;
       }
 
@@ -86,6 +95,36 @@ namespace MR
         return __tmpfile_prefix;
       }
 
+      //CONF option: PipeInSharedMemory
+      //CONF default: 0 (false)
+      //CONF Whether to store images passed between commands via Unix pipes
+      //CONF in shared memory (the /dev/shm RAM filesystem, where available)
+      //CONF rather than in the folder specified by :option:`TmpFileDir`. In
+      //CONF this case, the receiving command maps the very same memory pages
+      //CONF as the sending command, without any copy. This is only used if
+      //CONF the shared memory filesystem has sufficient free space to hold
+      //CONF the image; otherwise :option:`TmpFileDir` is used. This option
+      //CONF has no effect if a temporary file location has been set
+      //CONF explicitly using :option:`TmpFileDir`. Note that the free
+      //CONF space check cannot account for other commands in the same
+      //CONF pipeline filling the shared memory filesystem concurrently.
+      inline const std::string& pipe_tmpfile_dir (int64_t size) {
+#ifndef MRTRIX_WINDOWS
+        static const bool use_shared_memory = File::Config::get_bool ("PipeInSharedMemory", false);
+        static const std::string shared_memory_dir = "/dev/shm";
+        if (use_shared_memory && user_tmpfile_dir().empty() && Path::is_dir (shared_memory_dir) && !access (shared_memory_dir.c_str(), W_OK)) {
+          // writing to a memory-mapped file on a full tmpfs results in a bus
+          // error, so leave ample room for other images in the pipeline:
+          struct statvfs fsbuf;
+          if (!statvfs (shared_memory_dir.c_str(), &fsbuf) &&
+              int64_t (fsbuf.f_bavail) * int64_t (fsbuf.f_frsize) > 2*size + (int64_t(1)<<20))
+            return shared_memory_dir;
+          DEBUG ("insufficient space in shared memory for piped image - using folder \"" + tmpfile_dir() + "\"");
+        }
+#endif
+        return tmpfile_dir();
+      }
+
       /* Config file options listed here so that they can be scraped by
        * generate_user_docs.sh and added to the list of config file options in
        * the documentation without modifying the script to read from the scripts
@@ -173,11 +212,11 @@ namespace MR
 
 
 
-    inline std::string create_tempfile (int64_t size = 0, const char* suffix = NULL)
+    inline std::string create_tempfile (int64_t size = 0, const char* suffix = NULL, const std::string& folder = tmpfile_dir())
     {
       DEBUG ("creating temporary file of size " + str (size));
 
-      std::string filename (Path::join (tmpfile_dir(), tmpfile_prefix()) + "XXXXXX.");
+      std::string filename (Path::join (folder, tmpfile_prefix()) + "XXXXXX.");
       int rand_index = filename.size() - 7;
       if (suffix) filename += suffix;
 
@@ -189,7 +228,7 @@ namespace MR
       } while (fid < 0 && errno == EEXIST);
 
       if (fid < 0)
-        throw Exception (std::string ("error creating temporary file in directory \"" + tmpfile_dir() + "\": ") + strerror (errno));
+        throw Exception (std::string ("error creating temporary file in directory \"" + folder + "\": ") + strerror (errno));
 
 
 
@@ -22,7 +22,6 @@
 
 #include "filter/base.h"
 
-#include <stack>
 #include <iostream>
 
 namespace MR
@@ -58,22 +57,8 @@ namespace MR
 
         // Perform connected components on the mask.
         const vector<vector<int> >& run (vector<cluster>& clusters,
-                                                   vector<uint32_t>& labels) const {
-          labels.resize (adjacent_indices.size(), 0);
-          uint32_t current_label = 1;
-          for (uint32_t i = 0; i < labels.size(); i++) {
-            // this node has not been already clustered
-            if (labels[i] == 0) {
-              cluster cluster;
-              cluster.label = current_label;
-              cluster.size = 0;
-              depth_first_search (i, cluster, labels);
-              clusters.push_back (cluster);
-              current_label++;
-            }
-          }
-          if (clusters.size() > std::numeric_limits<uint32_t>::max())
-            throw Exception ("The number of clusters is larger than can be labelled with an unsigned 32bit integer.");
+                                         vector<uint32_t>& labels) const {
+          label ([] (uint32_t) { return true; }, clusters, labels);
           return mask_indices;
         }
 
@@ -84,21 +69,7 @@ namespace MR
                   vector<uint32_t>& labels,
                   const VectorType& data,
                   const float threshold) const {
-          labels.resize (adjacent_indices.size(), 0);
-          uint32_t current_label = 1;
-          for (uint32_t i = 0; i < labels.size(); i++) {
-            // this node has not been already clustered and is above threshold
-            if (labels[i] == 0 && data[i] > threshold) {
-              cluster cluster;
-              cluster.label = current_label;
-              cluster.size = 0;
-              depth_first_search (i, cluster, labels, data, threshold);
-              clusters.push_back (cluster);
-              current_label++;
-            }
-          }
-          if (clusters.size() > std::numeric_limits<uint32_t>::max())
-            throw Exception ("The number of clusters is larger than can be labelled with an unsigned 32bit integer.");
+          label ([&] (uint32_t i) { return data[i] > threshold; }, clusters, labels);
         }
 
 
@@ -112,22 +83,30 @@ namespace MR
         template <class MaskImageType>
         const vector<vector<int> >& precompute_adjacency (MaskImageType& mask) {
 
+          const uint32_t outside = std::numeric_limits<uint32_t>::max();
           auto index_image = Image<uint32_t>::scratch (mask);
 
           // 1st pass, store mask image indices and their index in the array
           for (auto l = Loop (mask) (mask, index_image); l; ++l) {
             if (mask.value() >= 0.5) {
               // For each voxel, store the index within mask_indices for 2nd pass
+              if (mask_indices.size() == outside)
+                throw Exception ("Too many voxels in mask for connected components analysis");
               index_image.value() = mask_indices.size();
               vector<int> index (mask.ndim());
               for (size_t dim = 0; dim < mask.ndim(); dim++)
                 index[dim] = mask.index(dim);
               mask_indices.push_back (index);
             } else {
-              index_image.value() = 0;
+              index_image.value() = outside;
             }
           }
-          // Here we pre-compute the offsets for our neighbours in 4D space
+
+          // Here we pre-compute the offsets for our neighbours in 4D space.
+          // Only those neighbours preceding the voxel in raster order (i.e.
+          //   whose highest-dimension non-zero offset is negative) are needed:
+          //   every adjacency is then stored exactly once, which is all the
+          //   union-find labelling requires
           vector< vector<int> > neighbour_offsets;
           vector<int> offset (4);
           for (offset[0] = -1; offset[0] <= 1; offset[0]++) {
@@ -139,112 +118,116 @@ namespace MR
                   if ((abs(offset[0]) && dim_to_ignore[0]) || (abs(offset[1]) && dim_to_ignore[1]) ||
                       (abs(offset[2]) && dim_to_ignore[2]) || (abs(offset[3]) && dim_to_ignore[3]))
                     continue;
-                  neighbour_offsets.push_back (offset);
+                  int leading = 0;
+                  for (size_t dim = 0; dim < 4; ++dim)
+                    if (offset[dim])
+                      leading = offset[dim];
+                  if (leading < 0)
+                    neighbour_offsets.push_back (offset);
                 }
               }
             }
           }
-          // 2nd pass, define adjacency
-          MaskImageType mask_neigh (mask);
+
+          // 2nd pass, define adjacency in compressed sparse row format
+          adjacency_offsets.assign (1, 0);
+          adjacency_offsets.reserve (mask_indices.size() + 1);
+          adjacent_indices.clear();
           for (vector<vector<int> >::const_iterator it = mask_indices.begin(); it != mask_indices.end(); ++it) {
-            vector<uint32_t> neighbour_indices;
             for (vector< vector<int> >::const_iterator offset = neighbour_offsets.begin(); offset != neighbour_offsets.end(); ++offset) {
-              for (size_t dim = 0; dim < mask.ndim(); dim++)
-                mask_neigh.index(dim) = (*it)[dim] + (*offset)[dim];
-              if (!is_out_of_bounds (mask_neigh)) {
-                if (mask_neigh.value() >= 0.5) {
-                  assign_pos_of (mask_neigh).to (index_image);
-                  neighbour_indices.push_back (index_image.value());
+              bool in_bounds = true;
+              for (size_t dim = 0; dim < mask.ndim(); dim++) {
+                const int pos = (*it)[dim] + (*offset)[dim];
+                if (pos < 0 || pos >= index_image.size (dim)) {
+                  in_bounds = false;
+                  break;
                 }
+                index_image.index(dim) = pos;
+              }
+              if (in_bounds) {
+                const uint32_t neighbour = index_image.value();
+                if (neighbour != outside)
+                  adjacent_indices.push_back (neighbour);
               }
             }
-            adjacent_indices.push_back (neighbour_indices);
+            adjacency_offsets.push_back (adjacent_indices.size());
           }
+          adjacent_indices.shrink_to_fit();
 
           return mask_indices;
         }
 
 
-        bool next_neighbour (uint32_t& node, vector<uint32_t>& labels) const {
-          for (size_t n = 0; n < adjacent_indices[node].size(); n++) {
-            if (labels[adjacent_indices[node][n]] == 0) {
-              node = adjacent_indices[node][n];
-              return true;
-            }
-          }
-          return false;
-        }
+        bool do_26_connectivity;
+        vector<bool> dim_to_ignore;
+        vector<vector<int> > mask_indices;
+        // Adjacency in compressed sparse row format: the preceding neighbours
+        //   of node i are adjacent_indices[adjacency_offsets[i]] up to
+        //   (but excluding) adjacent_indices[adjacency_offsets[i+1]]
+        vector<uint32_t> adjacency_offsets;
+        vector<uint32_t> adjacent_indices;
 
 
-        template <class VectorType>
-        bool next_neighbour (uint32_t& node,
-                             vector<uint32_t>& labels,
-                             const VectorType& data,
-                             const float threshold) const {
-          for (size_t n = 0; n < adjacent_indices[node].size(); n++) {
-            if (labels[adjacent_indices[node][n]] == 0 && data[adjacent_indices[node][n]] > threshold) {
-              node = adjacent_indices[node][n];
-              return true;
-            }
-          }
-          return false;
-        }
+      protected:
 
+        // Two-pass union-find labelling:
+        //   since each node is only ever attached to a root of lower index,
+        //   the root of each component is its first node; the second pass
+        //   can therefore flatten the forest and assign labels in a single
+        //   sweep, producing the same labels (in order of first occurrence)
+        //   as a traversal-based search would
+        template <class IncludeFunctor>
+        void label (IncludeFunctor&& include,
+                    vector<cluster>& clusters,
+                    vector<uint32_t>& labels) const {
+          const uint32_t num_nodes = mask_indices.size();
+          vector<uint32_t> parent (num_nodes);
+
+          auto find = [&] (uint32_t node) {
+            while (parent[node] != node) {
+              parent[node] = parent[parent[node]];
+              node = parent[node];
+            }
+            return node;
+          };
 
-        // use a non-recursive depth first search to agglomerate adjacent voxels
-        void depth_first_search (uint32_t root,
-                                 cluster& cluster,
-                                 vector<uint32_t>& labels) const {
-          uint32_t node = root;
-          std::stack<uint32_t> stack;
-          while (true) {
-            labels[node] = cluster.label;
-            stack.push (node);
-            cluster.size++;
-            if (next_neighbour (node, labels)) {
+          for (uint32_t i = 0; i != num_nodes; ++i) {
+            if (!include (i))
               continue;
-            } else {
-              do {
-                if (stack.top() == root)
-                  return;
-                stack.pop();
-                node = stack.top();
-              } while (!next_neighbour (node, labels));
+            parent[i] = i;
+            for (uint32_t n = adjacency_offsets[i]; n != adjacency_offsets[i+1]; ++n) {
+              const uint32_t j = adjacent_indices[n];
+              if (!include (j))
+                continue;
+              const uint32_t root_i = find (i), root_j = find (j);
+              if (root_i < root_j)
+                parent[root_j] = root_i;
+              else if (root_j < root_i)
+                parent[root_i] = root_j;
             }
           }
-        }
 
-        // use a non-recursive depth first search to agglomerate adjacent voxels
-        template <class VectorType>
-        void depth_first_search (uint32_t root,
-                                 cluster& cluster,
-                                 vector<uint32_t>& labels,
-                                 const VectorType& data,
-                                 const float threshold) const {
-          uint32_t node = root;
-          std::stack<uint32_t> stack;
-          while (true) {
-            labels[node] = cluster.label;
-            stack.push (node);
-            cluster.size++;
-            if (next_neighbour (node, labels, data, threshold)) {
+          labels.assign (num_nodes, 0);
+          const size_t first_cluster = clusters.size();
+          for (uint32_t i = 0; i != num_nodes; ++i) {
+            if (!include (i))
               continue;
+            if (parent[i] == i) {
+              if (clusters.size() - first_cluster == std::numeric_limits<uint32_t>::max())
+                throw Exception ("The number of clusters is larger than can be labelled with an unsigned 32bit integer.");
+              cluster cluster;
+              cluster.label = clusters.size() - first_cluster + 1;
+              cluster.size = 0;
+              clusters.push_back (cluster);
+              labels[i] = cluster.label;
             } else {
-              do {
-                if (stack.top() == root)
-                  return;
-                stack.pop();
-                node = stack.top();
-              } while (!next_neighbour (node, labels, data, threshold));
+              // parent[i] < i has already been flattened to point to its root
+              parent[i] = parent[parent[i]];
+              labels[i] = labels[parent[i]];
             }
+            clusters[first_cluster + labels[i] - 1].size++;
           }
         }
-
-
-        bool do_26_connectivity;
-        vector<bool> dim_to_ignore;
-        vector<vector<int> > mask_indices;
-        vector<vector<uint32_t> > adjacent_indices;
     };
 
 
@@ -18,14 +18,13 @@
 
 #include <complex>
 
-#include <unsupported/Eigen/FFT>
-
 #include "datatype.h"
 #include "memory.h"
 #include "image.h"
 #include "algo/copy.h"
 #include "algo/threaded_copy.h"
 #include "filter/base.h"
+#include "math/fft.h"
 
 namespace MR
 {
@@ -131,29 +130,24 @@ namespace MR
           public:
             FFTKernel (const ComplexImageType& voxel, const size_t FFT_axis, const bool inverse_FFT) :
                 vox (voxel),
-                data_in (vox.size (FFT_axis)),
-                data_out (data_in.size()),
-                axis (FFT_axis),
-                inverse (inverse_FFT) { }
+                data (vox.size (FFT_axis)),
+                fft (data.size(), inverse_FFT),
+                axis (FFT_axis) { }
 
             void operator () (const Iterator& pos) {
               assign_pos_of (pos).to (vox);
               for (vox.index(axis) = 0; vox.index(axis) < vox.size(axis); ++vox.index(axis))
-                data_in[vox.index(axis)] = cdouble (vox.value());
-              if (inverse)
-                fft.inv (data_out, data_in);
-              else
-                fft.fwd (data_out, data_in);
+                data[vox.index(axis)] = cdouble (vox.value());
+              fft (data.data());
               for (vox.index(axis) = 0; vox.index(axis) < vox.size(axis); ++vox.index(axis))
-                vox.value() = typename ComplexImageType::value_type (data_out[vox.index(axis)]);
+                vox.value() = typename ComplexImageType::value_type (data[vox.index(axis)]);
             }
 
           protected:
             ComplexImageType vox;
-            Eigen::Matrix<cdouble, Eigen::Dynamic, 1> data_in, data_out;
-            Eigen::FFT<double> fft;
+            vector<cdouble> data;
+            Math::FFT<double> fft;
             size_t axis;
-            bool inverse;
         };
 
     };
@@ -169,22 +163,18 @@ namespace MR
 
         struct Kernel { MEMALIGN(Kernel)
           Kernel (const ImageType& v, size_t axis, bool inverse) :
-            data_in (v.size (axis)), data_out (data_in.size()), axis (axis), inverse (inverse) { }
+            data (v.size (axis)), fft (data.size(), inverse), axis (axis) { }
 
           void operator ()(ImageType& v) {
             for (auto l = Loop (axis, axis+1) (v); l; ++l)
-              data_in[v[axis]] = cdouble (v.value());
-            if (inverse)
-              fft.inv (data_out, data_in);
-            else
-              fft.fwd (data_out, data_in);
+              data[v[axis]] = cdouble (v.value());
+            fft (data.data());
             for (auto l = Loop (axis, axis+1) (v); l; ++l)
-              v.value() = typename std::remove_reference<ImageType>::type::value_type (data_out[v[axis]]);
+              v.value() = typename std::remove_reference<ImageType>::type::value_type (data[v[axis]]);
           }
-          Eigen::FFT<double> fft;
-          Eigen::Matrix<cdouble, Eigen::Dynamic, 1> data_in, data_out;
+          vector<cdouble> data;
+          Math::FFT<double> fft;
           const size_t axis;
-          const bool inverse;
         } kernel (vox, axis, inverse);
 
         ThreadedLoop ("performing in-place FFT", vox, axes)
@@ -17,18 +17,238 @@
 #define __image_filter_median_h__
 
 #include "image.h"
-#include "algo/threaded_copy.h"
-#include "adapter/median.h"
+#include "algo/threaded_loop.h"
 #include "filter/base.h"
+#include "math/median.h"
 
 namespace MR
 {
   namespace Filter
   {
+    namespace
+    {
+
+      // The values within the neighbourhood of each voxel along a row of the
+      // image, with the neighbourhood sliding one voxel along the first axis
+      // at a time. Each column of the neighbourhood (i.e. the values at a
+      // particular position along the first axis) is read once per row, and
+      // is then added to and later removed from the window as a whole.
+      // All values in the row are sorted once to map them to their rank
+      // among the distinct values in that row, and the window is stored as a
+      // two-level histogram over these ranks (as in Perreault & Hebert's
+      // median filter): adding or removing a value takes constant time, and
+      // any order statistic is found by scanning the coarse histogram and
+      // then a single block of the fine one. NaNs are ignored; for the median
+      // (50th percentile), both the result and the handling of NaNs are
+      // identical to Math::median().
+      template <typename ValueType>
+        class PercentileWindow { MEMALIGN(PercentileWindow<ValueType>)
+          public:
+            PercentileWindow (const size_t num_columns, const default_type percentile) :
+              column_start (num_columns+1, 0),
+              fraction (percentile / 100.0),
+              count (0) { }
+
+            // columns must be loaded in order, starting from zero for each row
+            void start_column (const ssize_t x) {
+              if (!x)
+                values.clear();
+              column_start[x] = values.size();
+            }
+            void push (const ssize_t, const ValueType value) {
+              if (!Math::not_a_number (value))
+                values.push_back (value);
+            }
+
+            //! map the values of all columns in the row to ranks, and empty the window
+            void prepare () {
+              column_start.back() = values.size();
+              sorted.resize (values.size());
+              for (uint32_t n = 0; n != values.size(); ++n)
+                sorted[n] = { values[n], n };
+              std::sort (sorted.begin(), sorted.end());
+              ranks.resize (values.size());
+              distinct.clear();
+              for (const auto& entry : sorted) {
+                if (distinct.empty() || entry.first != distinct.back())
+                  distinct.push_back (entry.first);
+                ranks[entry.second] = distinct.size() - 1;
+              }
+              counts.assign (distinct.size(), 0);
+              block_counts.assign ((distinct.size() + block_size - 1) / block_size, 0);
+              count = 0;
+            }
+
+            //! remove column \a removed and add column \a added (either may be negative to denote none)
+            void update (const ssize_t removed, const ssize_t added) {
+              if (removed >= 0) {
+                for (size_t n = column_start[removed]; n != column_start[removed+1]; ++n) {
+                  --counts[ranks[n]];
+                  --block_counts[ranks[n] / block_size];
+                }
+                count -= column_start[removed+1] - column_start[removed];
+              }
+              if (added >= 0) {
+                for (size_t n = column_start[added]; n != column_start[added+1]; ++n) {
+                  ++counts[ranks[n]];
+                  ++block_counts[ranks[n] / block_size];
+                }
+                count += column_start[added+1] - column_start[added];
+              }
+            }
+
+            ValueType value () const {
+              if (!count)
+                return std::numeric_limits<ValueType>::quiet_NaN();
+              const default_type position = fraction * (count - 1);
+              const size_t lower = std::floor (position);
+              const default_type weight = position - lower;
+              const ValueType lower_value = distinct[nth (lower)];
+              if (!weight)
+                return lower_value;
+              return (1.0 - weight) * lower_value + weight * distinct[nth (lower + 1)];
+            }
+
+          private:
+            static constexpr size_t block_size = 64;
+
+            vector<ValueType> values;
+            vector<size_t> column_start;
+            vector<std::pair<ValueType,uint32_t>> sorted;
+            vector<uint32_t> ranks;
+            vector<ValueType> distinct;
+            vector<uint32_t> counts, block_counts;
+            const default_type fraction;
+            size_t count;
+
+            // rank of the n'th smallest value in the window (counting from zero)
+            size_t nth (size_t n) const {
+              size_t block = 0;
+              while (block_counts[block] <= n)
+                n -= block_counts[block++];
+              size_t rank = block * block_size;
+              while (counts[rank] <= n)
+                n -= counts[rank++];
+              return rank;
+            }
+        };
+
+
+      // for binary images, all that is needed is the number of true values
+      template <>
+        class PercentileWindow<bool> { NOMEMALIGN
+          public:
+            PercentileWindow (const size_t num_columns, const default_type percentile) :
+              columns (num_columns),
+              fraction (percentile / 100.0),
+              total (0),
+              num_true (0) { }
+
+            void start_column (const ssize_t x) { columns[x] = { 0, 0 }; }
+            void push (const ssize_t x, const bool value) {
+              ++columns[x].first;
+              columns[x].second += value;
+            }
+
+            void prepare () { total = num_true = 0; }
+
+            void update (const ssize_t removed, const ssize_t added) {
+              if (removed >= 0) {
+                total -= columns[removed].first;
+                num_true -= columns[removed].second;
+              }
+              if (added >= 0) {
+                total += columns[added].first;
+                num_true += columns[added].second;
+              }
+            }
+
+            // the sorted window holds (total - num_true) false values followed
+            // by num_true true values; as for the median of an even number of
+            // values, ties between the two are resolved in favour of true
+            bool value () const {
+              if (!total)
+                return false;
+              const default_type position = fraction * (total - 1);
+              const size_t lower = std::floor (position);
+              const default_type weight = position - lower;
+              const size_t num_false = total - num_true;
+              const default_type lower_value = lower >= num_false;
+              const default_type upper_value = weight ? (lower + 1 >= num_false) : lower_value;
+              return (1.0 - weight) * lower_value + weight * upper_value >= 0.5;
+            }
+
+          private:
+            vector<std::pair<size_t,size_t>> columns;
+            const default_type fraction;
+            size_t total, num_true;
+        };
+
+
+
+      template <class InputImageType, class OutputImageType>
+        class PercentileSlice { MEMALIGN(PercentileSlice<InputImageType,OutputImageType>)
+          public:
+            using value_type = typename InputImageType::value_type;
+
+            PercentileSlice (const InputImageType& in, const OutputImageType& out, const vector<int>& half_extent, const default_type percentile) :
+              in (in), out (out), extent (half_extent), window (in.size(0), percentile) { }
+
+            void operator() (const Iterator& pos) {
+              assign_pos_of (pos, 2).to (in, out);
+              const ssize_t z = in.index(2);
+              const ssize_t z_from = std::max (z - extent[2], ssize_t(0));
+              const ssize_t z_to = std::min (z + extent[2] + 1, in.size(2));
+
+              for (out.index(1) = 0; out.index(1) < out.size(1); ++out.index(1)) {
+                const ssize_t y = out.index(1);
+                const ssize_t y_from = std::max (y - extent[1], ssize_t(0));
+                const ssize_t y_to = std::min (y + extent[1] + 1, in.size(1));
+
+                for (ssize_t x = 0; x < in.size(0); ++x)
+                  load_column (x, y_from, y_to, z_from, z_to);
+                window.prepare();
+
+                for (ssize_t x = 0; x < std::min (ssize_t(extent[0]), in.size(0)); ++x)
+                  window.update (-1, x);
+
+                for (out.index(0) = 0; out.index(0) < out.size(0); ++out.index(0)) {
+                  const ssize_t x = out.index(0);
+                  const ssize_t removed = x - extent[0] - 1;
+                  const ssize_t added = x + extent[0] < in.size(0) ? x + extent[0] : -1;
+                  window.update (removed, added);
+                  out.value() = window.value();
+                }
+              }
+            }
+
+          protected:
+            InputImageType in;
+            OutputImageType out;
+            const vector<int> extent;
+            PercentileWindow<value_type> window;
+
+            void load_column (const ssize_t x, const ssize_t y_from, const ssize_t y_to, const ssize_t z_from, const ssize_t z_to) {
+              window.start_column (x);
+              in.index(0) = x;
+              for (in.index(2) = z_from; in.index(2) < z_to; ++in.index(2))
+                for (in.index(1) = y_from; in.index(1) < y_to; ++in.index(1))
+                  window.push (x, in.value());
+            }
+        };
+
+    }
+
+
+
     /** \addtogroup Filters
     @{ */
 
     /*! Smooth images using median filtering.
+     *
+     * More generally, any percentile of the values within the neighbourhood
+     * of each voxel can be computed instead, using set_percentile(); values
+     * at intermediate ranks are linearly interpolated.
      *
      * Typical usage:
      * \code
@@ -45,28 +265,32 @@ namespace MR
         template <class HeaderType>
         Median (const HeaderType& in) :
             Base (in),
-            extent (1,3) {
+            extent (1,3),
+            percentile (50.0) {
           datatype() = DataType::Float32;
         }
 
         template <class HeaderType>
           Median (const HeaderType& in, const std::string& message) :
             Base (in, message),
-            extent (1,3) { 
+            extent (1,3),
+            percentile (50.0) {
               datatype() = DataType::Float32;
             }
 
         template <class HeaderType>
         Median (const HeaderType& in, const vector<int>& extent) :
             Base (in),
-            extent (extent) {
+            extent (extent),
+            percentile (50.0) {
           datatype() = DataType::Float32;
         }
 
         template <class HeaderType>
           Median (const HeaderType& in, const std::string& message, const vector<int>& extent) :
             Base (in, message),
-            extent (extent) { 
+            extent (extent),
+            percentile (50.0) {
               datatype() = DataType::Float32;
             }
 
@@ -83,17 +307,40 @@ namespace MR
           extent = ext;
         }
 
+        //! Set the percentile of the neighbourhood values to be computed,
+        //! between 0 (minimum) and 100 (maximum). Default 50 (median).
+        void set_percentile (const default_type value) {
+          if (value < 0.0 || value > 100.0)
+            throw Exception ("percentile must be between 0 and 100");
+          percentile = value;
+        }
+
+        //! The neighbourhood of each voxel is updated incrementally as the
+        //! filter slides along the first image axis, with each thread
+        //! processing a different slice. For the median, this gives the same
+        //! result as Adapter::Median, at a fraction of the cost for larger
+        //! extents.
         template <class InputImageType, class OutputImageType>
         void operator() (InputImageType& in, OutputImageType& out) {
-          Adapter::Median<InputImageType> median (in, extent);
+          vector<int> half_extent (extent.size() == 1 ? vector<int> (3, extent[0]) : extent);
+          if (half_extent.size() != 3)
+            throw Exception ("unexpected number of elements specified in extent");
+          for (auto& e : half_extent)
+            e = (e-1)/2;
+
+          vector<size_t> outer_axes;
+          for (size_t n = 2; n < in.ndim(); ++n)
+            outer_axes.push_back (n);
+          PercentileSlice<InputImageType,OutputImageType> functor (in, out, half_extent, percentile);
           if (message.size())
-            threaded_copy_with_progress_message (message, median, out);
+            ThreadedLoop (message, in, outer_axes, { 0, 1 }).run_outer (functor);
           else
-            threaded_copy (median, out);
+            ThreadedLoop (in, outer_axes, { 0, 1 }).run_outer (functor);
         }
 
     protected:
         vector<int> extent;
+        default_type percentile;
     };
     //! @}
   }
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2008-2018 the MRtrix3 contributors.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at http://mozilla.org/MPL/2.0/
+ *
+ * MRtrix3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * For more details, see http://www.mrtrix.org/
+ */
+
+
+#include "filter/resample_operator.h"
+#include "app.h"
+#include "datatype.h"
+#include "file/key_value.h"
+#include "file/ofstream.h"
+
+namespace MR
+{
+  namespace Filter
+  {
+
+    namespace {
+      const char* operator_first_line = "mrtrix resample operator";
+
+      std::string transform_to_string (const transform_type& T) {
+        std::string s;
+        for (ssize_t i = 0; i < 3; ++i)
+          for (ssize_t j = 0; j < 4; ++j)
+            s += (s.size() ? "," : "") + str (T(i,j), 10);
+        return s;
+      }
+
+      transform_type transform_from_string (const std::string& s) {
+        const auto V = parse_floats (s);
+        if (V.size() != 12)
+          throw Exception ("malformed transform in resample operator file");
+        transform_type T;
+        for (ssize_t i = 0; i < 3; ++i)
+          for (ssize_t j = 0; j < 4; ++j)
+            T(i,j) = V[4*i+j];
+        return T;
+      }
+
+      template <typename T>
+        void write_vector (File::OFStream& out, const vector<T>& V) {
+          out.write (reinterpret_cast<const char*> (V.data()), V.size() * sizeof(T));
+        }
+
+      template <typename T>
+        void read_vector (std::ifstream& in, vector<T>& V, size_t size) {
+          V.resize (size);
+          in.read (reinterpret_cast<char*> (V.data()), size * sizeof(T));
+        }
+    }
+
+
+
+    ResampleOperator::ResampleOperator (const Header& source, const Header& destination, const std::string& interpolator) :
+      source_transform (source.transform()),
+      destination_transform (destination.transform()),
+      interp (interpolator),
+      oversampling (false)
+    {
+      if (voxel_count (source, 0, 3) > std::numeric_limits<index_type>::max())
+        throw Exception ("image \"" + source.name() + "\" is too large for resampling operator");
+      for (size_t i = 0; i < 3; ++i) {
+        source_dim[i] = source.size(i);
+        source_spacing[i] = source.spacing(i);
+        destination_dim[i] = destination.size(i);
+        destination_spacing[i] = destination.spacing(i);
+      }
+    }
+
+
+
+    Header ResampleOperator::destination_header (const Header& source) const
+    {
+      Header H (source);
+      for (size_t i = 0; i < 3; ++i) {
+        H.size(i) = destination_dim[i];
+        H.spacing(i) = destination_spacing[i];
+      }
+      H.transform() = destination_transform;
+      return H;
+    }
+
+
+
+    void ResampleOperator::save (const std::string& filename) const
+    {
+      if (!row_start.size())
+        throw Exception ("cannot save uninitialised resampling operator");
+
+      File::OFStream out (filename, std::ios::out | std::ios::binary | std::ios::trunc);
+      DataType index_dtype (DataType::from<index_type>()), weight_dtype (DataType::from<weight_type>());
+      index_dtype.set_byte_order_native();
+      weight_dtype.set_byte_order_native();
+
+      out << operator_first_line << "\n";
+      out << "source_dim: " << source_dim[0] << "," << source_dim[1] << "," << source_dim[2] << "\n";
+      out << "source_vox: " << str(source_spacing[0], 10) << "," << str(source_spacing[1], 10) << "," << str(source_spacing[2], 10) << "\n";
+      out << "source_transform: " << transform_to_string (source_transform) << "\n";
+      out << "dim: " << destination_dim[0] << "," << destination_dim[1] << "," << destination_dim[2] << "\n";
+      out << "vox: " << str(destination_spacing[0], 10) << "," << str(destination_spacing[1], 10) << "," << str(destination_spacing[2], 10) << "\n";
+      out << "transform: " << transform_to_string (destination_transform) << "\n";
+      out << "interp: " << interp << "\n";
+      out << "oversampling: " << ( oversampling ? "1" : "0" ) << "\n";
+      out << "count: " << num_entries() << "\n";
+      out << "index_datatype: " << index_dtype.specifier() << "\n";
+      out << "weight_datatype: " << weight_dtype.specifier() << "\n";
+      int64_t data_offset = int64_t(out.tellp()) + 32;
+      data_offset += (8 - (data_offset % 8)) % 8;
+      out << "file: . " << data_offset << "\nEND\n";
+      out.seekp (data_offset);
+
+      write_vector (out, row_start);
+      write_vector (out, source_index);
+      write_vector (out, weights);
+      if (!out.good())
+        throw Exception ("error writing resample operator file \"" + filename + "\": " + strerror (errno));
+    }
+
+
+
+    void ResampleOperator::load (const std::string& filename)
+    {
+      File::KeyValue kv (filename, operator_first_line);
+      int64_t data_offset = -1;
+      uint64_t count = 0;
+      std::string index_dtype, weight_dtype;
+      for (size_t i = 0; i < 3; ++i)
+        source_dim[i] = destination_dim[i] = 0;
+      auto parse_dim = [&](ssize_t* dim) {
+        const auto V = parse_ints (kv.value());
+        if (V.size() != 3)
+          throw Exception ("malformed dimensions in resample operator file \"" + filename + "\"");
+        for (size_t i = 0; i < 3; ++i) dim[i] = V[i];
+      };
+      auto parse_vox = [&](default_type* vox) {
+        const auto V = parse_floats (kv.value());
+        if (V.size() != 3)
+          throw Exception ("malformed voxel sizes in resample operator file \"" + filename + "\"");
+        for (size_t i = 0; i < 3; ++i) vox[i] = V[i];
+      };
+
+      while (kv.next()) {
+        const std::string key = lowercase (kv.key());
+        if (key == "source_dim") parse_dim (source_dim);
+        else if (key == "source_vox") parse_vox (source_spacing);
+        else if (key == "source_transform") source_transform = transform_from_string (kv.value());
+        else if (key == "dim") parse_dim (destination_dim);
+        else if (key == "vox") parse_vox (destination_spacing);
+        else if (key == "transform") destination_transform = transform_from_string (kv.value());
+        else if (key == "interp") interp = kv.value();
+        else if (key == "oversampling") oversampling = to<bool> (kv.value());
+        else if (key == "count") count = to<uint64_t> (kv.value());
+        else if (key == "index_datatype") index_dtype = kv.value();
+        else if (key == "weight_datatype") weight_dtype = kv.value();
+        else if (key == "file") {
+          const auto entries = split (kv.value(), " ", true);
+          if (entries.size() != 2 || entries[0] != ".")
+            throw Exception ("resample operator data must be stored in the same file (\"" + filename + "\")");
+          data_offset = to<int64_t> (entries[1]);
+        }
+      }
+      kv.close();
+
+      DataType native_index (DataType::from<index_type>()), native_weight (DataType::from<weight_type>());
+      native_index.set_byte_order_native();
+      native_weight.set_byte_order_native();
+      if (data_offset < 0 || index_dtype != native_index.specifier() || weight_dtype != native_weight.specifier())
+        throw Exception ("resample operator file \"" + filename + "\" is invalid or was written on a system with different byte order");
+
+      for (size_t i = 0; i < 3; ++i) {
+        if (source_dim[i] <= 0 || destination_dim[i] <= 0)
+          throw Exception ("missing or invalid image dimensions in resample operator file \"" + filename + "\"");
+      }
+
+      std::ifstream in (filename, std::ios::in | std::ios::binary);
+      in.seekg (data_offset);
+      read_vector (in, row_start, destination_dim[0] * destination_dim[1] * destination_dim[2] + 1);
+      read_vector (in, source_index, count);
+      read_vector (in, weights, count);
+      if (!in.good())
+        throw Exception ("error reading resample operator file \"" + filename + "\"");
+
+      // guard against out-of-bounds access in apply() for corrupt files:
+      if (row_start.front() != 0 || row_start.back() != count)
+        throw Exception ("inconsistent row offsets in resample operator file \"" + filename + "\"");
+      for (size_t r = 1; r < row_start.size(); ++r) {
+        if (row_start[r] < row_start[r-1])
+          throw Exception ("inconsistent row offsets in resample operator file \"" + filename + "\"");
+      }
+      const uint64_t num_source_voxels = uint64_t (source_dim[0]) * uint64_t (source_dim[1]) * uint64_t (source_dim[2]);
+      for (const auto n : source_index) {
+        if (uint64_t (n) >= num_source_voxels)
+          throw Exception ("source voxel index out of range in resample operator file \"" + filename + "\"");
+      }
+      INFO ("resampling operator loaded from \"" + filename + "\" with " + str(count) + " non-zero weights");
+    }
+
+
+  }
+}
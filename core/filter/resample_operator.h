@@ -0,0 +1,420 @@
+/*
+ * Copyright (c) 2008-2018 the MRtrix3 contributors.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at http://mozilla.org/MPL/2.0/
+ *
+ * MRtrix3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * For more details, see http://www.mrtrix.org/
+ */
+
+
+#ifndef __filter_resample_operator_h__
+#define __filter_resample_operator_h__
+
+#include "header.h"
+#include "image_helpers.h"
+#include "transform.h"
+#include "types.h"
+#include "adapter/reslice.h"
+#include "algo/threaded_loop.h"
+#include "filter/reslice.h"
+#include "interp/nearest.h"
+#include "interp/linear.h"
+#include "interp/cubic.h"
+#include "math/cubic_spline.h"
+
+namespace MR
+{
+  namespace Filter
+  {
+
+    //! \cond skip
+    namespace
+    {
+      // Compute the (source voxel, weight) pairs that the corresponding
+      // interpolator would use at voxel position P. Returns false if P lies
+      // outside the source image, using the same convention as Interp::Base.
+      template <template <class ImageType> class Interpolator>
+        struct ResampleWeights { NOMEMALIGN };
+
+      inline bool resample_in_bounds (const Eigen::Vector3& P, const ssize_t* dim) {
+        for (size_t i = 0; i < 3; ++i)
+          if (!(P[i] > -0.5 && P[i] < dim[i] - 0.5))
+            return false;
+        return true;
+      }
+
+      inline ssize_t resample_clamp (ssize_t x, ssize_t dim) {
+        return x < 0 ? 0 : ( x >= dim ? dim-1 : x );
+      }
+
+      template <> struct ResampleWeights<Interp::Nearest> { NOMEMALIGN
+        static constexpr const char* name = "nearest";
+        template <class AddFunctor>
+          static bool get (const Eigen::Vector3& P, const ssize_t* dim, default_type scale, AddFunctor& add) {
+            if (!resample_in_bounds (P, dim))
+              return false;
+            add (std::round (P[0]), std::round (P[1]), std::round (P[2]), scale);
+            return true;
+          }
+      };
+
+      template <> struct ResampleWeights<Interp::Linear> { NOMEMALIGN
+        static constexpr const char* name = "linear";
+        template <class AddFunctor>
+          static bool get (const Eigen::Vector3& P, const ssize_t* dim, default_type scale, AddFunctor& add) {
+            if (!resample_in_bounds (P, dim))
+              return false;
+            const ssize_t c[] = { ssize_t (std::floor (P[0])), ssize_t (std::floor (P[1])), ssize_t (std::floor (P[2])) };
+            default_type f[3];
+            for (size_t i = 0; i < 3; ++i)
+              f[i] = (P[i] < 0.0 || P[i] > dim[i]-1) ? 0.0 : P[i] - c[i];
+            for (ssize_t z = 0; z < 2; ++z) {
+              const default_type wz = z ? f[2] : 1.0 - f[2];
+              for (ssize_t y = 0; y < 2; ++y) {
+                const default_type wyz = wz * (y ? f[1] : 1.0 - f[1]);
+                for (ssize_t x = 0; x < 2; ++x) {
+                  const default_type w = wyz * (x ? f[0] : 1.0 - f[0]);
+                  if (w >= 1.0e-6)
+                    add (resample_clamp (c[0]+x, dim[0]), resample_clamp (c[1]+y, dim[1]), resample_clamp (c[2]+z, dim[2]), scale * w);
+                }
+              }
+            }
+            return true;
+          }
+      };
+
+      template <> struct ResampleWeights<Interp::Cubic> { NOMEMALIGN
+        static constexpr const char* name = "cubic";
+        template <class AddFunctor>
+          static bool get (const Eigen::Vector3& P, const ssize_t* dim, default_type scale, AddFunctor& add) {
+            if (!resample_in_bounds (P, dim))
+              return false;
+            Math::HermiteSpline<default_type> H[3] = { Math::SplineProcessingType::Value, Math::SplineProcessingType::Value, Math::SplineProcessingType::Value };
+            ssize_t c[3];
+            for (size_t i = 0; i < 3; ++i) {
+              H[i].set (P[i] - std::floor (P[i]));
+              c[i] = ssize_t (std::floor (P[i])) - 1;
+            }
+            for (ssize_t z = 0; z < 4; ++z) {
+              for (ssize_t y = 0; y < 4; ++y) {
+                const default_type wyz = H[1].weights[y] * H[2].weights[z];
+                for (ssize_t x = 0; x < 4; ++x) {
+                  const default_type w = H[0].weights[x] * wyz;
+                  if (w != 0.0)
+                    add (resample_clamp (c[0]+x, dim[0]), resample_clamp (c[1]+y, dim[1]), resample_clamp (c[2]+z, dim[2]), scale * w);
+                }
+              }
+            }
+            return true;
+          }
+      };
+    }
+    //! \endcond
+
+
+
+    //! a precomputed sparse operator to regrid images onto a fixed target grid
+    /*! Regridding an image using Filter::reslice() or Filter::warp()
+     * recomputes the source coordinates and interpolation weights of every
+     * output voxel, for every image and every volume. When the same spatial
+     * transformation is applied to many images sharing the same grid, the
+     * ResampleOperator allows these weights to be computed once and stored as
+     * a sparse matrix (in compressed row format: one row per voxel of the
+     * target grid, one column per voxel of the source grid). Applying it then
+     * reduces to a sparse matrix-vector product, performed for all volumes of
+     * a 4D image in a single pass over the target grid.
+     *
+     * The operator can be saved to file using save(), and loaded again using
+     * the constructor taking a file name. Only the Interp::Nearest,
+     * Interp::Linear and Interp::Cubic interpolators are supported.
+     *
+     * For example:
+     * \code
+     * auto source = Image<float>::open (argument[0]);
+     * auto template_header = Header::open (argument[1]);
+     *
+     * auto op = Filter::ResampleOperator::from_transform<Interp::Linear> (source, template_header, transform);
+     * op.save ("operator.txt");
+     *
+     * auto destination = Image<float>::create (argument[2], op.destination_header (source));
+     * op (source, destination);
+     * \endcode
+     */
+    class ResampleOperator
+    { NOMEMALIGN
+      public:
+        using index_type = uint32_t;
+        using weight_type = float;
+
+        ResampleOperator () : oversampling (false) { }
+
+        //! load a previously saved operator from file
+        ResampleOperator (const std::string& filename) : oversampling (false) { load (filename); }
+
+
+        //! compute the operator equivalent to Filter::reslice()
+        /*! The \a transform maps from scanner-space coordinates in the \a
+         * destination to scanner-space coordinates in the \a source image, as
+         * for Adapter::Reslice, and \a oversample has the same meaning. */
+        template <template <class ImageType> class Interpolator>
+          static ResampleOperator from_transform (const Header& source,
+                                                  const Header& destination,
+                                                  const transform_type& transform = Adapter::NoTransform,
+                                                  const vector<int>& oversample = Adapter::AutoOverSample)
+          {
+            ResampleOperator op (source, destination, ResampleWeights<Interpolator>::name);
+            const transform_type direct_transform (Transform(source).scanner2voxel * transform * Transform(destination).voxel2scanner);
+
+            int OS[3];
+            if (oversample.size()) {
+              assert (oversample.size() == 3);
+              if (oversample[0] < 1 || oversample[1] < 1 || oversample[2] < 1)
+                throw Exception ("oversample factors must be greater than zero");
+              for (size_t i = 0; i < 3; ++i)
+                OS[i] = oversample[i];
+            }
+            else {
+              const Eigen::Vector3 y = direct_transform * Eigen::Vector3 (0.0, 0.0, 0.0);
+              for (size_t i = 0; i < 3; ++i)
+                OS[i] = std::ceil ((1.0-std::numeric_limits<default_type>::epsilon()) * (y - direct_transform * Eigen::Vector3::Unit(i)).norm());
+            }
+            op.oversampling = OS[0] * OS[1] * OS[2] > 1;
+            if (op.oversampling)
+              INFO ("using oversampling factors [ " + str (OS[0]) + " " + str (OS[1]) + " " + str (OS[2]) + " ]");
+
+            default_type inc[3], from[3];
+            for (size_t i = 0; i < 3; ++i) {
+              inc[i] = 1.0 / default_type (OS[i]);
+              from[i] = 0.5 * (inc[i]-1.0);
+            }
+            const default_type norm = 1.0 / (OS[0] * OS[1] * OS[2]);
+
+            op.build (destination, [&](const ssize_t* x, const ssize_t* dim, Row& row) {
+                Eigen::Vector3 s;
+                for (int z = 0; z < OS[2]; ++z) {
+                  s[2] = x[2] + from[2] + z*inc[2];
+                  for (int y = 0; y < OS[1]; ++y) {
+                    s[1] = x[1] + from[1] + y*inc[1];
+                    for (int x0 = 0; x0 < OS[0]; ++x0) {
+                      s[0] = x[0] + from[0] + x0*inc[0];
+                      ResampleWeights<Interpolator>::get (direct_transform * s, dim, norm, row);
+                    }
+                  }
+                }
+              });
+            return op;
+          }
+
+
+        //! compute the operator equivalent to Filter::warp()
+        /*! The deformation field \a warp holds the scanner-space position to
+         * sample in the \a source for each of its voxels. As in Filter::warp(),
+         * it will first be resliced onto the \a destination grid (using \a
+         * oversample) if the two grids do not match. */
+        template <template <class ImageType> class Interpolator, class WarpType>
+          static ResampleOperator from_deformation (const Header& source,
+                                                    const Header& destination,
+                                                    WarpType& warp,
+                                                    const vector<int>& oversample = Adapter::AutoOverSample)
+          {
+            if (warp.transform().matrix() != destination.transform().matrix() ||
+                !dimensions_match (warp, destination, 0, 3) ||
+                !spacings_match (warp, destination, 0, 3)) {
+              Header header (destination);
+              header.ndim() = 4;
+              header.size(3) = 3;
+              Stride::set (header, Stride::contiguous_along_axis (3, header));
+              auto warp_resliced = Image<typename WarpType::value_type>::scratch (header);
+              reslice<Interp::Cubic> (warp, warp_resliced, Adapter::NoTransform, oversample);
+              return from_deformation<Interpolator> (source, destination, warp_resliced);
+            }
+
+            ResampleOperator op (source, destination, ResampleWeights<Interpolator>::name);
+            const transform_type scanner2voxel (Transform(source).scanner2voxel);
+            op.build (destination, [warp, &scanner2voxel](const ssize_t* x, const ssize_t* dim, Row& row) mutable {
+                for (size_t i = 0; i < 3; ++i)
+                  warp.index(i) = x[i];
+                const Eigen::Vector3 pos = warp.row(3);
+                if (pos.allFinite())
+                  ResampleWeights<Interpolator>::get (scanner2voxel * pos, dim, 1.0, row);
+              });
+            return op;
+          }
+
+
+        //! apply the operator to all volumes of \a source, writing into \a destination
+        /*! \a source must match the source grid of the operator, and \a
+         * destination the target grid. Target voxels that sample no source
+         * voxel are set to \a value_when_out_of_bounds (or zero when
+         * over-sampling, to match Adapter::Reslice). */
+        template <class ImageTypeSource, class ImageTypeDestination>
+          void operator() (ImageTypeSource& source,
+                           ImageTypeDestination& destination,
+                           const typename ImageTypeDestination::value_type value_when_out_of_bounds = Interp::Base<ImageTypeDestination>::default_out_of_bounds_value()) const
+          {
+            using value_type = typename ImageTypeDestination::value_type;
+            check (source, destination);
+            const size_t nvol = source.ndim() > 3 ? source.size(3) : 1;
+            const value_type empty = oversampling ? value_type(0) : value_when_out_of_bounds;
+
+            struct Apply { NOMEMALIGN
+              const ResampleOperator& op;
+              ImageTypeSource source;
+              const size_t nvol;
+              const value_type empty;
+              Eigen::Matrix<default_type, Eigen::Dynamic, 1> sum;
+
+              void operator() (ImageTypeDestination& destination) {
+                const size_t r = op.row_index (destination.index(0), destination.index(1), destination.index(2));
+                const uint64_t begin = op.row_start[r], end = op.row_start[r+1];
+                if (begin == end) {
+                  for (size_t v = 0; v < nvol; ++v) {
+                    if (nvol > 1) destination.index(3) = v;
+                    destination.value() = empty;
+                  }
+                  return;
+                }
+                sum.setZero (nvol);
+                for (uint64_t n = begin; n < end; ++n) {
+                  op.source_position (op.source_index[n], source);
+                  const default_type w = op.weights[n];
+                  if (nvol > 1) {
+                    for (size_t v = 0; v < nvol; ++v) {
+                      source.index(3) = v;
+                      sum[v] += w * source.value();
+                    }
+                  }
+                  else
+                    sum[0] += w * source.value();
+                }
+                for (size_t v = 0; v < nvol; ++v) {
+                  if (nvol > 1) destination.index(3) = v;
+                  destination.value() = Adapter::normalise<value_type> (sum[v], 1.0);
+                }
+              }
+            } kernel = { *this, source, nvol, empty, Eigen::Matrix<default_type, Eigen::Dynamic, 1> (nvol) };
+
+            ThreadedLoop ("resampling \"" + source.name() + "\"", destination, 0, 3, 2).run (kernel, destination);
+          }
+
+
+        //! return a header for the output of applying the operator to \a source
+        Header destination_header (const Header& source) const;
+
+        //! write the operator to file
+        void save (const std::string& filename) const;
+
+        //! read the operator from file
+        void load (const std::string& filename);
+
+        size_t num_rows () const { return row_start.size() ? row_start.size() - 1 : 0; }
+        size_t num_entries () const { return weights.size(); }
+        const std::string& interpolator () const { return interp; }
+
+
+      protected:
+        class Row { NOMEMALIGN
+          public:
+            Row (const ssize_t* dim, vector<index_type>& index, vector<weight_type>& weight) :
+              dim (dim), index (index), weight (weight) { }
+            void operator() (ssize_t x, ssize_t y, ssize_t z, default_type w) {
+              index.push_back (x + dim[0] * (y + dim[1] * z));
+              weight.push_back (w);
+            }
+          protected:
+            const ssize_t* dim;
+            vector<index_type>& index;
+            vector<weight_type>& weight;
+        };
+
+        ssize_t source_dim[3], destination_dim[3];
+        transform_type source_transform, destination_transform;
+        default_type source_spacing[3], destination_spacing[3];
+        std::string interp;
+        bool oversampling;
+
+        vector<uint64_t> row_start;
+        vector<index_type> source_index;
+        vector<weight_type> weights;
+
+        ResampleOperator (const Header& source, const Header& destination, const std::string& interpolator);
+
+        FORCE_INLINE size_t row_index (ssize_t x, ssize_t y, ssize_t z) const {
+          return x + destination_dim[0] * (y + destination_dim[1] * z);
+        }
+
+        template <class ImageType>
+          FORCE_INLINE void source_position (index_type index, ImageType& image) const {
+            image.index(0) = index % source_dim[0];
+            index /= source_dim[0];
+            image.index(1) = index % source_dim[1];
+            image.index(2) = index / source_dim[1];
+          }
+
+        // compute all rows, one slice of the destination grid at a time per thread:
+        template <class Functor>
+          void build (const Header& destination, Functor&& functor)
+          {
+            struct Slice { NOMEMALIGN
+              vector<uint64_t> row_size;
+              vector<index_type> index;
+              vector<weight_type> weight;
+            };
+            vector<Slice> slices (destination_dim[2]);
+
+            ThreadedLoop ("computing resampling operator", destination, vector<size_t> ({ 2 }), vector<size_t>())
+              .run_outer ([&](const Iterator& pos) {
+                  Slice& slice = slices[pos.index(2)];
+                  typename std::remove_reference<Functor>::type func (functor);
+                  Row row (source_dim, slice.index, slice.weight);
+                  ssize_t x[3] = { 0, 0, ssize_t (pos.index(2)) };
+                  for (x[1] = 0; x[1] < destination_dim[1]; ++x[1]) {
+                    for (x[0] = 0; x[0] < destination_dim[0]; ++x[0]) {
+                      const size_t previous = slice.index.size();
+                      func (x, source_dim, row);
+                      slice.row_size.push_back (slice.index.size() - previous);
+                    }
+                  }
+                });
+
+            row_start.assign (1, 0);
+            row_start.reserve (destination_dim[0] * destination_dim[1] * destination_dim[2] + 1);
+            for (auto& slice : slices) {
+              for (auto n : slice.row_size)
+                row_start.push_back (row_start.back() + n);
+              source_index.insert (source_index.end(), slice.index.begin(), slice.index.end());
+              weights.insert (weights.end(), slice.weight.begin(), slice.weight.end());
+              slice = Slice();
+            }
+            INFO ("resampling operator computed with " + str(num_entries()) + " non-zero weights");
+          }
+
+        template <class ImageTypeSource, class ImageTypeDestination>
+          void check (const ImageTypeSource& source, const ImageTypeDestination& destination) const
+          {
+            if (!row_start.size())
+              throw Exception ("resampling operator has not been initialised");
+            for (size_t i = 0; i < 3; ++i) {
+              if (source.size(i) != source_dim[i])
+                throw Exception ("dimensions of image \"" + source.name() + "\" do not match source grid of resampling operator");
+              if (destination.size(i) != destination_dim[i])
+                throw Exception ("dimensions of image \"" + destination.name() + "\" do not match target grid of resampling operator");
+            }
+            if (!source.transform().isApprox (source_transform, 1.0e-5))
+              WARN ("transform of image \"" + source.name() + "\" does not match source grid of resampling operator");
+            if (source.ndim() > 4 || destination.ndim() != source.ndim() || (source.ndim() == 4 && source.size(3) != destination.size(3)))
+              throw Exception ("resampling operator can only be applied to 3D or 4D images with matching number of volumes");
+          }
+    };
+
+
+  }
+}
+
+#endif
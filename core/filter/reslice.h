@@ -25,6 +25,27 @@ namespace MR
   namespace Filter
   {
 
+    namespace {
+      template <class ResliceType>
+        class ResliceRowKernel { MEMALIGN(ResliceRowKernel<ResliceType>)
+          public:
+            ResliceRowKernel (const ResliceType& reslicer) : reslicer (reslicer) { }
+
+            template <class ImageType>
+              void operator() (ImageType& out) {
+                for (size_t n = 0; n < 3; ++n)
+                  reslicer.index(n) = out.index(n);
+                reslicer.row (values, 3);
+                out.row(3) = values;
+              }
+
+          protected:
+            ResliceType reslicer;
+            Eigen::Matrix<typename ResliceType::value_type, Eigen::Dynamic, 1> values;
+        };
+    }
+
+
     //! convenience function to regrid one Image onto another
     /*! This function resamples (regrids) the Image \a source onto the
      * Image& \a destination, using the templated interpolator class.
@@ -52,6 +73,12 @@ namespace MR
           const typename ImageTypeDestination::value_type value_when_out_of_bounds = Interp::Base<ImageTypeDestination>::default_out_of_bounds_value())
       {
         Adapter::Reslice<Interpolator, ImageTypeSource> interp (source, destination, transform, oversampling, value_when_out_of_bounds);
+        if (destination.ndim() == 4 && destination.size(3) > 1) {
+          // interpolate all volumes at once, to avoid recomputing the interpolation weights for each volume
+          ThreadedLoop ("reslicing \"" + source.name() + "\"", destination, 0, 3, 2)
+            .run (ResliceRowKernel<decltype(interp)> (interp), destination);
+          return;
+        }
         threaded_copy_with_progress_message ("reslicing \"" + source.name() + "\"", interp, destination, 0, source.ndim(), 2);
       }
 
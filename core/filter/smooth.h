@@ -53,7 +53,8 @@ namespace MR
             extent (3, 0),
             stdev (3, 0.0),
             stride_order (Stride::order (in)),
-            zero_boundary (false)
+            zero_boundary (false),
+            recursive (false)
         {
           for (int i = 0; i < 3; i++)
             stdev[i] = in.spacing(i);
@@ -65,7 +66,9 @@ namespace MR
             Base (in),
             extent (3, 0),
             stdev (3, 0.0),
-            stride_order (Stride::order (in))
+            stride_order (Stride::order (in)),
+            zero_boundary (false),
+            recursive (false)
         {
           set_stdev (stdev_in);
           datatype() = DataType::Float32;
@@ -100,6 +103,14 @@ namespace MR
           zero_boundary = do_zero_boundary;
         }
 
+        //! use a recursive (IIR) approximation to the Gaussian, whose cost is independent of its width.
+        //! The kernel is then not truncated, and any extent set is ignored. Axes with a standard
+        //! deviation of less than one voxel, for which the approximation is less accurate and an
+        //! explicit kernel is cheap, are still smoothed using an explicit kernel.
+        void set_recursive (bool use_recursive) {
+          recursive = use_recursive;
+        }
+
         //! Set the standard deviation of the Gaussian defined in mm.
         //! This must be set as a single value to be used for the first 3 dimensions
         //! or separate values, one for each dimension. (Default: 1 voxel)
@@ -125,6 +136,11 @@ namespace MR
         {
           std::shared_ptr <Image<ValueType> > in (make_shared<Image<ValueType> > (Image<ValueType>::scratch (input)));
           threaded_copy (input, *in);
+          if (recursive) {
+            (*this) (*in);
+            threaded_copy (*in, output);
+            return;
+          }
           std::shared_ptr <Image<ValueType> > out;
 
           std::unique_ptr<ProgressBar> progress;
@@ -172,9 +188,17 @@ namespace MR
                   continue;
                 axes[axdim++] = stride_order[i];
               }
-              DEBUG ("smoothing dimension " + str(dim) + " in place with stride order: " + str(axes));
-              SmoothFunctor1D<ImageType> smooth (in_and_output, stdev[dim], dim, extent[dim], zero_boundary);
-              ThreadedLoop (in_and_output, axes, 1).run (smooth, in_and_output);
+              if (recursive && stdev[dim] >= in_and_output.spacing (dim)) {
+                // lines are processed in blocks along the axis with the smallest stride:
+                std::swap (axes[0], axes[1]);
+                DEBUG ("smoothing dimension " + str(dim) + " in place using recursive filter with stride order: " + str(axes));
+                RecursiveSmoothFunctor1D<ImageType> smooth (in_and_output, stdev[dim], dim, axes[0], zero_boundary);
+                ThreadedLoop (in_and_output, axes, 2).run_outer (smooth);
+              } else {
+                DEBUG ("smoothing dimension " + str(dim) + " in place with stride order: " + str(axes));
+                SmoothFunctor1D<ImageType> smooth (in_and_output, stdev[dim], dim, extent[dim], zero_boundary);
+                ThreadedLoop (in_and_output, axes, 1).run (smooth, in_and_output);
+              }
               if (progress)
                 ++(*progress);
             }
@@ -186,6 +210,7 @@ namespace MR
         vector<default_type> stdev;
         const vector<size_t> stride_order;
         bool zero_boundary;
+        bool recursive;
 
         template <class ImageType>
           class SmoothFunctor1D { MEMALIGN (SmoothFunctor1D)
@@ -284,6 +309,164 @@ namespace MR
             ssize_t buffer_size;
             Eigen::VectorXd buffer;
           };
+
+
+
+        // Recursive Gaussian filter along one axis (Young & van Vliet, Signal
+        // Processing 44:139-151, 1995; with the pole parameterisation of van
+        // Vliet et al., Proc. ICPR 1998), with the anti-causal pass initialised
+        // from the exact continuation of the causal pass beyond the image edge
+        // (as in Triggs & Sdika, IEEE TSP 54:2365-2367, 2006). As with the
+        // explicit kernel, values outside the image and non-finite values are
+        // excluded, by filtering the data and their weights separately
+        // (normalised convolution). Each invocation processes all lines in
+        // one plane, in blocks of adjacent lines filtered in lockstep.
+        template <class ImageType>
+          class RecursiveSmoothFunctor1D { MEMALIGN (RecursiveSmoothFunctor1D)
+          public:
+            enum { lanes = 8 };
+            using block_type = Eigen::Array<default_type, Eigen::Dynamic, lanes, Eigen::RowMajor>;
+            using lane_type = Eigen::Array<default_type, 1, lanes>;
+
+            RecursiveSmoothFunctor1D (ImageType& image,
+                                      default_type stdev,
+                                      size_t axis,
+                                      size_t lane_axis,
+                                      bool zero_boundary) :
+                image (image),
+                axis (axis),
+                lane_axis (lane_axis),
+                zero_boundary (zero_boundary),
+                data (image.size (axis), lanes),
+                weights (image.size (axis), lanes)
+            {
+              const default_type sigma = stdev / image.spacing (axis);
+              assert (sigma >= 0.5);
+              // poles of the third-order filter with optimal (L-infinity) fit
+              // to a Gaussian of unit scale; these are scaled as d^(1/q), with
+              // q set such that the variance of the combined causal and
+              // anti-causal filter is exactly sigma^2:
+              const std::complex<default_type> d0 (1.41650, 1.00829);
+              const default_type d2 (1.86543);
+              auto variance = [&] (default_type q) {
+                const auto p0 = std::pow (d0, 1.0/q);
+                const default_type p2 = std::pow (d2, 1.0/q);
+                return 4.0 * (p0 / ((p0 - 1.0) * (p0 - 1.0))).real() + 2.0 * p2 / ((p2 - 1.0) * (p2 - 1.0));
+              };
+              default_type q_low = 0.1, q_high = sigma;
+              while (variance (q_high) < sigma*sigma)
+                q_high *= 2.0;
+              for (size_t iter = 0; iter < 100; ++iter) {
+                const default_type q = 0.5 * (q_low + q_high);
+                (variance (q) < sigma*sigma ? q_low : q_high) = q;
+              }
+              const default_type q = 0.5 * (q_low + q_high);
+              const auto p0 = std::pow (d0, 1.0/q);
+              const default_type p2 = std::pow (d2, 1.0/q);
+              // expand (1 - z^-1/p0) (1 - z^-1/conj(p0)) (1 - z^-1/p2):
+              const default_type r = 1.0 / std::norm (p0), s = 2.0 * (1.0/p0).real(), t = 1.0 / p2;
+              a[0] = s + t;
+              a[1] = -(r + s*t);
+              a[2] = r*t;
+              B = 1.0 - (a[0] + a[1] + a[2]);
+
+              // map from the last three outputs of the causal pass to the
+              // first three (out-of-image) inputs to the anti-causal pass,
+              // obtained by running both passes over the zero-input tail:
+              const ssize_t tail = 100 + 40 * std::ceil (sigma);
+              vector<default_type> w (tail+3), y (tail+3);
+              for (size_t i = 0; i < 3; ++i) {
+                std::fill (w.begin(), w.end(), 0.0);
+                std::fill (y.begin(), y.end(), 0.0);
+                w[2-i] = 1.0;
+                for (ssize_t n = 3; n < tail+3; ++n)
+                  w[n] = a[0]*w[n-1] + a[1]*w[n-2] + a[2]*w[n-3];
+                for (ssize_t n = tail-1; n >= 0; --n)
+                  y[n] = B*w[n+3] + a[0]*y[n+1] + a[1]*y[n+2] + a[2]*y[n+3];
+                for (size_t j = 0; j < 3; ++j)
+                  M(j,i) = y[j];
+              }
+
+              // normalisation for lines with all values finite:
+              weights.setOnes();
+              filter (weights);
+              norm = weights.col(0);
+            }
+
+            void operator() (const Iterator& pos)
+            {
+              assign_pos_of (pos).to (image);
+              const ssize_t size = image.size (axis);
+              for (ssize_t first = 0; first < image.size (lane_axis); first += lanes) {
+                const ssize_t count = std::min (ssize_t (lanes), image.size (lane_axis) - first);
+                bool all_finite = true;
+                data.setZero();
+                for (image.index (axis) = 0; image.index (axis) < size; ++image.index (axis)) {
+                  for (image.index (lane_axis) = first; image.index (lane_axis) < first + count; ++image.index (lane_axis)) {
+                    const default_type value = image.value();
+                    if (std::isfinite (value))
+                      data (image.index (axis), image.index (lane_axis) - first) = value;
+                    else
+                      all_finite = false;
+                  }
+                }
+
+                filter (data);
+
+                if (all_finite) {
+                  data.colwise() /= norm;
+                } else {
+                  for (ssize_t n = 0; n < size; ++n) {
+                    for (ssize_t l = 0; l < count; ++l) {
+                      image.index (axis) = n;
+                      image.index (lane_axis) = first + l;
+                      weights (n, l) = std::isfinite (default_type (image.value())) ? 1.0 : 0.0;
+                    }
+                  }
+                  weights.rightCols (lanes - count).setZero();
+                  filter (weights);
+                  data /= weights;
+                }
+
+                if (zero_boundary) {
+                  data.row (0).setZero();
+                  data.row (size-1).setZero();
+                }
+
+                for (image.index (axis) = 0; image.index (axis) < size; ++image.index (axis))
+                  for (image.index (lane_axis) = first; image.index (lane_axis) < first + count; ++image.index (lane_axis))
+                    image.value() = data (image.index (axis), image.index (lane_axis) - first);
+              }
+            }
+
+          private:
+            ImageType image;
+            const size_t axis, lane_axis;
+            const bool zero_boundary;
+            default_type a[3], B;
+            Eigen::Matrix3d M;
+            block_type data, weights;
+            Eigen::ArrayXd norm;
+
+            void filter (block_type& x) const
+            {
+              const ssize_t size = x.rows();
+              // causal pass, with zero initial conditions:
+              lane_type w1 = lane_type::Zero(), w2 = lane_type::Zero(), w3 = lane_type::Zero();
+              for (ssize_t n = 0; n < size; ++n) {
+                x.row(n) = B * x.row(n) + a[0] * w1 + a[1] * w2 + a[2] * w3;
+                w3 = w2; w2 = w1; w1 = x.row(n);
+              }
+              // anti-causal pass:
+              lane_type y1 = M(0,0) * w1 + M(0,1) * w2 + M(0,2) * w3;
+              lane_type y2 = M(1,0) * w1 + M(1,1) * w2 + M(1,2) * w3;
+              lane_type y3 = M(2,0) * w1 + M(2,1) * w2 + M(2,2) * w3;
+              for (ssize_t n = size-1; n >= 0; --n) {
+                x.row(n) = B * x.row(n) + a[0] * y1 + a[1] * y2 + a[2] * y3;
+                y3 = y2; y2 = y1; y1 = x.row(n);
+              }
+            }
+          };
     };
     //! @}
   }
@@ -17,6 +17,7 @@
 #include "file/utils.h"
 #include "file/path.h"
 #include "header.h"
+#include "image_helpers.h"
 #include "image_io/pipe.h"
 #include "formats/list.h"
 
@@ -59,7 +60,7 @@ namespace MR
       if (H.name() != "-")
         return false;
 
-      H.name() = File::create_tempfile (0, "mif");
+      H.name() = File::create_tempfile (0, "mif", File::pipe_tmpfile_dir (footprint (H)));
 
       SignalHandler::mark_file_for_deletion (H.name());
 
@@ -93,6 +93,28 @@ namespace MR
           else buffer->set_value (data_offset, val);
         }
 
+        //! get \a count voxel values along \a axis, starting from the current location
+        /*! This is equivalent to reading the values one at a time while
+         * incrementing the index along \a axis, but performs any conversion
+         * from the stored data type in bulk. The current location is not
+         * modified. */
+        FORCE_INLINE void get_values (size_t axis, ValueType* values, size_t count) const {
+          if (data_pointer) {
+            for (size_t n = 0; n < count; ++n)
+              values[n] = Raw::fetch_native<ValueType> (data_pointer, data_offset + ssize_t(n) * stride (axis));
+          }
+          else buffer->get_values (data_offset, stride (axis), values, count);
+        }
+        //! set \a count voxel values along \a axis, starting from the current location
+        /*! \sa get_values() */
+        FORCE_INLINE void set_values (size_t axis, const ValueType* values, size_t count) {
+          if (data_pointer) {
+            for (size_t n = 0; n < count; ++n)
+              Raw::store_native<ValueType> (values[n], data_pointer, data_offset + ssize_t(n) * stride (axis));
+          }
+          else buffer->set_values (data_offset, stride (axis), values, count);
+        }
+
         //! use for debugging
         friend std::ostream& operator<< (std::ostream& stream, const Image& V) {
           stream << "\"" << V.name() << "\", datatype " << DataType::from<Image::value_type>().specifier() << ", index [ ";
@@ -214,24 +236,47 @@ namespace MR
   template <typename ValueType> 
     class Image<ValueType>::Buffer : public Header { MEMALIGN (Image<ValueType>::Buffer)
       public:
-        Buffer() {} // TODO: delete this line! Only for testing memory alignment issues.
+        Buffer() : access_type (DataType::Undefined), fetch_func (nullptr), store_func (nullptr), fetch_row_func (nullptr), store_row_func (nullptr) {} // TODO: delete this line! Only for testing memory alignment issues.
         //! construct a Buffer object to access the data in the image specified
         Buffer (Header& H, bool read_write_if_existing = false);
         Buffer (Buffer&&) = default;
         Buffer& operator= (const Buffer&) = delete;
         Buffer& operator= (Buffer&&) = default;
         Buffer (const Buffer& b) : 
-          Header (b), fetch_func (b.fetch_func), store_func (b.store_func) { }
+          Header (b), access_type (b.access_type), fetch_func (b.fetch_func), store_func (b.store_func),
+          fetch_row_func (b.fetch_row_func), store_row_func (b.store_row_func) { }
 
 
         FORCE_INLINE ValueType get_value (size_t offset) const {
           ssize_t nseg = offset / io->segment_size();
-          return fetch_func (io->segment (nseg), offset - nseg*io->segment_size(), intensity_offset(), intensity_scale());
+          return __fetch_value (access_type, fetch_func, io->segment (nseg), offset - nseg*io->segment_size(), intensity_offset(), intensity_scale());
         }
 
         FORCE_INLINE void set_value (size_t offset, ValueType val) const {
           ssize_t nseg = offset / io->segment_size();
-          store_func (val, io->segment (nseg), offset - nseg*io->segment_size(), intensity_offset(), intensity_scale());
+          __store_value (access_type, store_func, val, io->segment (nseg), offset - nseg*io->segment_size(), intensity_offset(), intensity_scale());
+        }
+
+        void get_values (size_t offset, ssize_t stride, ValueType* values, size_t count) const {
+          if (!count) return;
+          ssize_t nseg = offset / io->segment_size();
+          if (ssize_t ((offset + (count-1)*stride) / io->segment_size()) == nseg)
+            fetch_row_func (values, io->segment (nseg), offset - nseg*io->segment_size(), stride, count, intensity_offset(), intensity_scale());
+          else {
+            for (size_t n = 0; n < count; ++n, offset += stride)
+              values[n] = get_value (offset);
+          }
+        }
+
+        void set_values (size_t offset, ssize_t stride, const ValueType* values, size_t count) const {
+          if (!count) return;
+          ssize_t nseg = offset / io->segment_size();
+          if (ssize_t ((offset + (count-1)*stride) / io->segment_size()) == nseg)
+            store_row_func (values, io->segment (nseg), offset - nseg*io->segment_size(), stride, count, intensity_offset(), intensity_scale());
+          else {
+            for (size_t n = 0; n < count; ++n, offset += stride)
+              set_value (offset, values[n]);
+          }
         }
 
         std::unique_ptr<uint8_t[]> data_buffer;
@@ -240,11 +285,17 @@ namespace MR
         FORCE_INLINE ImageIO::Base* get_io () const { return io.get(); }
 
       protected:
-        std::function<ValueType(const void*,size_t,default_type,default_type)> fetch_func;
-        std::function<void(ValueType,void*,size_t,default_type,default_type)> store_func;
+        //! storage type for which conversion is performed inline, if any
+        uint8_t access_type;
+        ValueType (*fetch_func) (const void*,size_t,default_type,default_type);
+        void (*store_func) (ValueType,void*,size_t,default_type,default_type);
+        void (*fetch_row_func) (ValueType*,const void*,size_t,ssize_t,size_t,default_type,default_type);
+        void (*store_row_func) (const ValueType*,void*,size_t,ssize_t,size_t,default_type,default_type);
 
         void set_fetch_store_functions () {
+          access_type = ImageIO::inline_access_type (datatype());
           __set_fetch_store_functions (fetch_func, store_func, datatype());
+          __set_fetch_store_row_functions (fetch_row_func, store_row_func, datatype());
         }
     };
 
@@ -309,7 +360,12 @@ namespace MR
 
   template <typename ValueType>
     Image<ValueType>::Buffer::Buffer (Header& H, bool read_write_if_existing) :
-      Header (H) {
+      Header (H),
+      access_type (DataType::Undefined),
+      fetch_func (nullptr),
+      store_func (nullptr),
+      fetch_row_func (nullptr),
+      store_row_func (nullptr) {
         assert (H.valid() && "IO handler must be set when creating an Image"); 
         assert ((H.is_file_backed() ? is_data_type<ValueType>::value : true) && "class types cannot be stored on file using the Image class");
 
@@ -454,7 +510,7 @@ namespace MR
 
       // try to dump file to mrtrix format if possible (direct IO)
       if (filename == "-")
-        filename = File::create_tempfile (0, "mif");
+        filename = File::create_tempfile (0, "mif", File::pipe_tmpfile_dir (footprint (*buffer)));
 
       DEBUG ("dumping image \"" + name() + "\" to file \"" + filename + "\"...");
 
@@ -17,6 +17,7 @@
 
 #include "app.h"
 #include "header.h"
+#include "thread_queue.h"
 #include "file/ofstream.h"
 #include "image_io/default.h"
 
@@ -99,10 +100,14 @@ namespace MR
 
       if (is_new) memset (addresses[0].get(), 0, files.size() * bytes_per_segment);
       else {
-        for (size_t n = 0; n < files.size(); n++) {
+        size_t next = 0;
+        auto loader = [&] (size_t& n) { n = next++; return n < files.size(); };
+        auto copy = [&] (const size_t& n) {
           File::MMap file (files[n], false, false, bytes_per_segment);
           memcpy (addresses[0].get() + n*bytes_per_segment, file.address(), bytes_per_segment);
-        }
+          return true;
+        };
+        Thread::run_queue (loader, size_t(), Thread::multi (copy));
       }
 
       if (addresses.size() > 1)
@@ -22,77 +22,7 @@ namespace MR
   namespace
   {
 
-    // rounding to be applied during conversion:
-
-    // any -> floating-point
-    template <typename TypeOUT, typename TypeIN>
-      inline typename std::enable_if<std::is_floating_point<TypeOUT>::value, TypeOUT>::type 
-      round_func (TypeIN in, typename std::enable_if<std::is_arithmetic<TypeIN>::value>::type* = nullptr) {
-        return in;
-      }
-
-    // integer -> integer
-    template <typename TypeOUT, typename TypeIN>
-      inline typename std::enable_if<std::is_integral<TypeOUT>::value, TypeOUT>::type 
-      round_func (TypeIN in, typename std::enable_if<std::is_integral<TypeIN>::value>::type* = nullptr) {
-        return in;
-      }
-
-    // floating-point -> integer
-    template <typename TypeOUT, typename TypeIN>
-      inline typename std::enable_if<std::is_integral<TypeOUT>::value, TypeOUT>::type 
-      round_func (TypeIN in, typename std::enable_if<std::is_floating_point<TypeIN>::value>::type* = nullptr) {
-        return std::isfinite (in) ? std::round (in) : TypeOUT (0);
-      }
-
-    // complex -> complex
-    template <typename TypeOUT, typename TypeIN>
-      inline typename std::enable_if<std::is_same<std::complex<typename TypeOUT::value_type>, TypeOUT>::value, TypeOUT>::type 
-      round_func (TypeIN in, typename std::enable_if<std::is_same<std::complex<typename TypeIN::value_type>, TypeIN>::value>::type* = nullptr) {
-        return TypeOUT (in);
-      }
-
-    // real -> complex
-    template <typename TypeOUT, typename TypeIN>
-      inline typename std::enable_if<std::is_same<std::complex<typename TypeOUT::value_type>, TypeOUT>::value, TypeOUT>::type 
-      round_func (TypeIN in, typename std::enable_if<std::is_arithmetic<TypeIN>::value>::type* = nullptr) {
-        return round_func<typename TypeOUT::value_type> (in);
-      }
-
-    // complex -> real
-    template <typename TypeOUT, typename TypeIN>
-      inline typename std::enable_if<std::is_arithmetic<TypeOUT>::value, TypeOUT>::type 
-      round_func (TypeIN in, typename std::enable_if<std::is_same<std::complex<typename TypeIN::value_type>, TypeIN>::value>::type* = nullptr) {
-        return round_func<TypeOUT> (in.real());
-      }
-
-
-
-    // apply scaling from storage:
-    template <typename DiskType>
-      inline typename std::enable_if<std::is_arithmetic<DiskType>::value, default_type>::type 
-      scale_from_storage (DiskType val, default_type offset, default_type scale) {
-        return offset + scale * val;
-      }
-
-    template <typename DiskType>
-      inline typename std::enable_if<std::is_same<std::complex<typename DiskType::value_type>, DiskType>::value, DiskType>::type 
-      scale_from_storage (DiskType val, default_type offset, default_type scale) {
-        return typename DiskType::value_type (offset) + typename DiskType::value_type (scale) * val;
-      }
-
-    // apply scaling to storage:
-    template <typename DiskType>
-      inline typename std::enable_if<std::is_arithmetic<DiskType>::value, default_type>::type 
-      scale_to_storage (DiskType val, default_type offset, default_type scale) {
-        return (val - offset) / scale;
-      }
-
-    template <typename DiskType>
-      inline typename std::enable_if<std::is_same<std::complex<typename DiskType::value_type>, DiskType>::value, DiskType>::type 
-      scale_to_storage (DiskType val, default_type offset, default_type scale) {
-        return (val - typename DiskType::value_type (offset)) / typename DiskType::value_type (scale);
-      }
+    using namespace ImageIO;
 
 
 
@@ -134,6 +64,51 @@ namespace MR
       }
 
 
+
+    // bulk conversion of runs of values, for each of the storage types above.
+    // The per-value operations are identical to those used in the
+    // single-value versions (so results are identical), but the loops are
+    // amenable to vectorisation by the compiler in the contiguous case:
+
+    template <typename DiskType> struct __Native { NOMEMALIGN
+      static FORCE_INLINE DiskType fetch (const void* data, size_t i) { return Raw::fetch<DiskType> (data, i); }
+      static FORCE_INLINE void store (DiskType val, void* data, size_t i) { Raw::store<DiskType> (val, data, i); }
+    };
+
+    template <typename DiskType> struct __LE { NOMEMALIGN
+      static FORCE_INLINE DiskType fetch (const void* data, size_t i) { return Raw::fetch_LE<DiskType> (data, i); }
+      static FORCE_INLINE void store (DiskType val, void* data, size_t i) { Raw::store_LE<DiskType> (val, data, i); }
+    };
+
+    template <typename DiskType> struct __BE { NOMEMALIGN
+      static FORCE_INLINE DiskType fetch (const void* data, size_t i) { return Raw::fetch_BE<DiskType> (data, i); }
+      static FORCE_INLINE void store (DiskType val, void* data, size_t i) { Raw::store_BE<DiskType> (val, data, i); }
+    };
+
+    template <typename RAMType, typename DiskType, class Access>
+      void __fetch_row (RAMType* values, const void* data, size_t i, ssize_t stride, size_t count, default_type offset, default_type scale) {
+        if (stride == 1) {
+          for (size_t n = 0; n < count; ++n)
+            values[n] = round_func<RAMType> (scale_from_storage (Access::fetch (data, i+n), offset, scale));
+        }
+        else {
+          for (size_t n = 0; n < count; ++n, i += stride)
+            values[n] = round_func<RAMType> (scale_from_storage (Access::fetch (data, i), offset, scale));
+        }
+      }
+
+    template <typename RAMType, typename DiskType, class Access>
+      void __store_row (const RAMType* values, void* data, size_t i, ssize_t stride, size_t count, default_type offset, default_type scale) {
+        if (stride == 1) {
+          for (size_t n = 0; n < count; ++n)
+            Access::store (round_func<DiskType> (scale_to_storage (values[n], offset, scale)), data, i+n);
+        }
+        else {
+          for (size_t n = 0; n < count; ++n, i += stride)
+            Access::store (round_func<DiskType> (scale_to_storage (values[n], offset, scale)), data, i);
+        }
+      }
+
   }
 
 
@@ -142,8 +117,8 @@ namespace MR
 
   template <typename ValueType>
     typename std::enable_if<is_data_type<ValueType>::value, void>::type __set_fetch_store_functions (
-        std::function<ValueType(const void*,size_t,default_type,default_type)>& fetch_func,
-        std::function<void(ValueType,void*,size_t,default_type,default_type)>& store_func, 
+        ValueType (*&fetch_func) (const void*,size_t,default_type,default_type),
+        void (*&store_func) (ValueType,void*,size_t,default_type,default_type), 
         DataType datatype) {
 
       switch (datatype()) {
@@ -244,6 +219,112 @@ namespace MR
       }
     }
 
+  template <typename ValueType>
+    typename std::enable_if<is_data_type<ValueType>::value, void>::type __set_fetch_store_row_functions (
+        void (*&fetch_row_func) (ValueType*,const void*,size_t,ssize_t,size_t,default_type,default_type),
+        void (*&store_row_func) (const ValueType*,void*,size_t,ssize_t,size_t,default_type,default_type),
+        DataType datatype) {
+
+      switch (datatype()) {
+        case DataType::Bit:
+          fetch_row_func = __fetch_row<ValueType,bool,__Native<bool>>;
+          store_row_func = __store_row<ValueType,bool,__Native<bool>>;
+          return;
+        case DataType::Int8:
+          fetch_row_func = __fetch_row<ValueType,int8_t,__Native<int8_t>>;
+          store_row_func = __store_row<ValueType,int8_t,__Native<int8_t>>;
+          return;
+        case DataType::UInt8:
+          fetch_row_func = __fetch_row<ValueType,uint8_t,__Native<uint8_t>>;
+          store_row_func = __store_row<ValueType,uint8_t,__Native<uint8_t>>;
+          return;
+        case DataType::Int16LE:
+          fetch_row_func = __fetch_row<ValueType,int16_t,__LE<int16_t>>;
+          store_row_func = __store_row<ValueType,int16_t,__LE<int16_t>>;
+          return;
+        case DataType::UInt16LE:
+          fetch_row_func = __fetch_row<ValueType,uint16_t,__LE<uint16_t>>;
+          store_row_func = __store_row<ValueType,uint16_t,__LE<uint16_t>>;
+          return;
+        case DataType::Int16BE:
+          fetch_row_func = __fetch_row<ValueType,int16_t,__BE<int16_t>>;
+          store_row_func = __store_row<ValueType,int16_t,__BE<int16_t>>;
+          return;
+        case DataType::UInt16BE:
+          fetch_row_func = __fetch_row<ValueType,uint16_t,__BE<uint16_t>>;
+          store_row_func = __store_row<ValueType,uint16_t,__BE<uint16_t>>;
+          return;
+        case DataType::Int32LE:
+          fetch_row_func = __fetch_row<ValueType,int32_t,__LE<int32_t>>;
+          store_row_func = __store_row<ValueType,int32_t,__LE<int32_t>>;
+          return;
+        case DataType::UInt32LE:
+          fetch_row_func = __fetch_row<ValueType,uint32_t,__LE<uint32_t>>;
+          store_row_func = __store_row<ValueType,uint32_t,__LE<uint32_t>>;
+          return;
+        case DataType::Int32BE:
+          fetch_row_func = __fetch_row<ValueType,int32_t,__BE<int32_t>>;
+          store_row_func = __store_row<ValueType,int32_t,__BE<int32_t>>;
+          return;
+        case DataType::UInt32BE:
+          fetch_row_func = __fetch_row<ValueType,uint32_t,__BE<uint32_t>>;
+          store_row_func = __store_row<ValueType,uint32_t,__BE<uint32_t>>;
+          return;
+        case DataType::Int64LE:
+          fetch_row_func = __fetch_row<ValueType,int64_t,__LE<int64_t>>;
+          store_row_func = __store_row<ValueType,int64_t,__LE<int64_t>>;
+          return;
+        case DataType::UInt64LE:
+          fetch_row_func = __fetch_row<ValueType,uint64_t,__LE<uint64_t>>;
+          store_row_func = __store_row<ValueType,uint64_t,__LE<uint64_t>>;
+          return;
+        case DataType::Int64BE:
+          fetch_row_func = __fetch_row<ValueType,int64_t,__BE<int64_t>>;
+          store_row_func = __store_row<ValueType,int64_t,__BE<int64_t>>;
+          return;
+        case DataType::UInt64BE:
+          fetch_row_func = __fetch_row<ValueType,uint64_t,__BE<uint64_t>>;
+          store_row_func = __store_row<ValueType,uint64_t,__BE<uint64_t>>;
+          return;
+        case DataType::Float32LE:
+          fetch_row_func = __fetch_row<ValueType,float,__LE<float>>;
+          store_row_func = __store_row<ValueType,float,__LE<float>>;
+          return;
+        case DataType::Float32BE:
+          fetch_row_func = __fetch_row<ValueType,float,__BE<float>>;
+          store_row_func = __store_row<ValueType,float,__BE<float>>;
+          return;
+        case DataType::Float64LE:
+          fetch_row_func = __fetch_row<ValueType,double,__LE<double>>;
+          store_row_func = __store_row<ValueType,double,__LE<double>>;
+          return;
+        case DataType::Float64BE:
+          fetch_row_func = __fetch_row<ValueType,double,__BE<double>>;
+          store_row_func = __store_row<ValueType,double,__BE<double>>;
+          return;
+        case DataType::CFloat32LE:
+          fetch_row_func = __fetch_row<ValueType,cfloat,__LE<cfloat>>;
+          store_row_func = __store_row<ValueType,cfloat,__LE<cfloat>>;
+          return;
+        case DataType::CFloat32BE:
+          fetch_row_func = __fetch_row<ValueType,cfloat,__BE<cfloat>>;
+          store_row_func = __store_row<ValueType,cfloat,__BE<cfloat>>;
+          return;
+        case DataType::CFloat64LE:
+          fetch_row_func = __fetch_row<ValueType,cdouble,__LE<cdouble>>;
+          store_row_func = __store_row<ValueType,cdouble,__LE<cdouble>>;
+          return;
+        case DataType::CFloat64BE:
+          fetch_row_func = __fetch_row<ValueType,cdouble,__BE<cdouble>>;
+          store_row_func = __store_row<ValueType,cdouble,__BE<cdouble>>;
+          return;
+        default:
+          throw Exception ("invalid data type in image header");
+      }
+    }
+
+
+
 #undef MRTRIX_EXTERN
 #define MRTRIX_EXTERN
   __DEFINE_FETCH_STORE_FUNCTIONS;
@@ -22,19 +22,210 @@
 namespace MR
 {
 
+  namespace ImageIO
+  {
+
+    // functions needed for conversion to/from storage:
+
+    // rounding to be applied during conversion:
+
+    // any -> floating-point
+    template <typename TypeOUT, typename TypeIN>
+      inline typename std::enable_if<std::is_floating_point<TypeOUT>::value, TypeOUT>::type 
+      round_func (TypeIN in, typename std::enable_if<std::is_arithmetic<TypeIN>::value>::type* = nullptr) {
+        return in;
+      }
+
+    // integer -> integer
+    template <typename TypeOUT, typename TypeIN>
+      inline typename std::enable_if<std::is_integral<TypeOUT>::value, TypeOUT>::type 
+      round_func (TypeIN in, typename std::enable_if<std::is_integral<TypeIN>::value>::type* = nullptr) {
+        return in;
+      }
+
+    // floating-point -> integer
+    template <typename TypeOUT, typename TypeIN>
+      inline typename std::enable_if<std::is_integral<TypeOUT>::value, TypeOUT>::type 
+      round_func (TypeIN in, typename std::enable_if<std::is_floating_point<TypeIN>::value>::type* = nullptr) {
+        return std::isfinite (in) ? std::round (in) : TypeOUT (0);
+      }
+
+    // complex -> complex
+    template <typename TypeOUT, typename TypeIN>
+      inline typename std::enable_if<std::is_same<std::complex<typename TypeOUT::value_type>, TypeOUT>::value, TypeOUT>::type 
+      round_func (TypeIN in, typename std::enable_if<std::is_same<std::complex<typename TypeIN::value_type>, TypeIN>::value>::type* = nullptr) {
+        return TypeOUT (in);
+      }
+
+    // real -> complex
+    template <typename TypeOUT, typename TypeIN>
+      inline typename std::enable_if<std::is_same<std::complex<typename TypeOUT::value_type>, TypeOUT>::value, TypeOUT>::type 
+      round_func (TypeIN in, typename std::enable_if<std::is_arithmetic<TypeIN>::value>::type* = nullptr) {
+        return round_func<typename TypeOUT::value_type> (in);
+      }
+
+    // complex -> real
+    template <typename TypeOUT, typename TypeIN>
+      inline typename std::enable_if<std::is_arithmetic<TypeOUT>::value, TypeOUT>::type 
+      round_func (TypeIN in, typename std::enable_if<std::is_same<std::complex<typename TypeIN::value_type>, TypeIN>::value>::type* = nullptr) {
+        return round_func<TypeOUT> (in.real());
+      }
+
+
+
+    // apply scaling from storage:
+    template <typename DiskType>
+      inline typename std::enable_if<std::is_arithmetic<DiskType>::value, default_type>::type 
+      scale_from_storage (DiskType val, default_type offset, default_type scale) {
+        return offset + scale * val;
+      }
+
+    template <typename DiskType>
+      inline typename std::enable_if<std::is_same<std::complex<typename DiskType::value_type>, DiskType>::value, DiskType>::type 
+      scale_from_storage (DiskType val, default_type offset, default_type scale) {
+        return typename DiskType::value_type (offset) + typename DiskType::value_type (scale) * val;
+      }
+
+    // apply scaling to storage:
+    template <typename DiskType>
+      inline typename std::enable_if<std::is_arithmetic<DiskType>::value, default_type>::type 
+      scale_to_storage (DiskType val, default_type offset, default_type scale) {
+        return (val - offset) / scale;
+      }
+
+    template <typename DiskType>
+      inline typename std::enable_if<std::is_same<std::complex<typename DiskType::value_type>, DiskType>::value, DiskType>::type 
+      scale_to_storage (DiskType val, default_type offset, default_type scale) {
+        return (val - typename DiskType::value_type (offset)) / typename DiskType::value_type (scale);
+      }
+
+
+
+    //! the data type to use for inline (non-virtual) access, if any
+    /*! For the most common storage types, when stored in native byte order,
+     * image values can be converted inline from the raw data, avoiding the
+     * overhead of an indirect function call per voxel. This returns the
+     * corresponding type identifier (without byte order flags), or
+     * DataType::Undefined if the function pointers need to be used. */
+    inline uint8_t inline_access_type (DataType datatype)
+    {
+      if (datatype.is_complex())
+        return DataType::Undefined;
+      DataType native (datatype);
+      native.set_byte_order_native();
+      if (native() != datatype())
+        return DataType::Undefined;
+      const uint8_t type = datatype() & ( DataType::Type | DataType::Signed );
+      switch (type) {
+        case DataType::Int8:
+        case DataType::UInt8:
+        case DataType::Int16:
+        case DataType::UInt16:
+        case DataType::Int32:
+        case DataType::UInt32:
+        case DataType::Float32:
+        case DataType::Float64:
+          return type;
+        default:
+          return DataType::Undefined;
+      }
+    }
+
+
+    template <typename ValueType, typename DiskType>
+      FORCE_INLINE ValueType fetch_inline (const void* data, size_t i, default_type offset, default_type scale) {
+        return round_func<ValueType> (scale_from_storage (Raw::fetch_native<DiskType> (data, i), offset, scale));
+      }
+
+    template <typename ValueType, typename DiskType>
+      FORCE_INLINE void store_inline (ValueType val, void* data, size_t i, default_type offset, default_type scale) {
+        Raw::store_native<DiskType> (round_func<DiskType> (scale_to_storage (val, offset, scale)), data, i);
+      }
+
+  }
+
+
+
+
+  //! fetch value using inline conversion for \a type if possible, or \a fetch_func otherwise
+  template <typename ValueType>
+    FORCE_INLINE typename std::enable_if<is_data_type<ValueType>::value, ValueType>::type __fetch_value (
+        uint8_t type, ValueType (*fetch_func) (const void*,size_t,default_type,default_type),
+        const void* data, size_t i, default_type offset, default_type scale) {
+      switch (type) {
+        case DataType::Int8:    return ImageIO::fetch_inline<ValueType,int8_t>   (data, i, offset, scale);
+        case DataType::UInt8:   return ImageIO::fetch_inline<ValueType,uint8_t>  (data, i, offset, scale);
+        case DataType::Int16:   return ImageIO::fetch_inline<ValueType,int16_t>  (data, i, offset, scale);
+        case DataType::UInt16:  return ImageIO::fetch_inline<ValueType,uint16_t> (data, i, offset, scale);
+        case DataType::Int32:   return ImageIO::fetch_inline<ValueType,int32_t>  (data, i, offset, scale);
+        case DataType::UInt32:  return ImageIO::fetch_inline<ValueType,uint32_t> (data, i, offset, scale);
+        case DataType::Float32: return ImageIO::fetch_inline<ValueType,float>    (data, i, offset, scale);
+        case DataType::Float64: return ImageIO::fetch_inline<ValueType,double>   (data, i, offset, scale);
+        default:                return fetch_func (data, i, offset, scale);
+      }
+    }
+
+  template <typename ValueType>
+    FORCE_INLINE typename std::enable_if<!is_data_type<ValueType>::value, ValueType>::type __fetch_value (
+        uint8_t /*type*/, ValueType (*fetch_func) (const void*,size_t,default_type,default_type),
+        const void* data, size_t i, default_type offset, default_type scale) {
+      return fetch_func (data, i, offset, scale);
+    }
+
+  //! store value using inline conversion for \a type if possible, or \a store_func otherwise
+  template <typename ValueType>
+    FORCE_INLINE typename std::enable_if<is_data_type<ValueType>::value, void>::type __store_value (
+        uint8_t type, void (*store_func) (ValueType,void*,size_t,default_type,default_type),
+        ValueType val, void* data, size_t i, default_type offset, default_type scale) {
+      switch (type) {
+        case DataType::Int8:    ImageIO::store_inline<ValueType,int8_t>   (val, data, i, offset, scale); return;
+        case DataType::UInt8:   ImageIO::store_inline<ValueType,uint8_t>  (val, data, i, offset, scale); return;
+        case DataType::Int16:   ImageIO::store_inline<ValueType,int16_t>  (val, data, i, offset, scale); return;
+        case DataType::UInt16:  ImageIO::store_inline<ValueType,uint16_t> (val, data, i, offset, scale); return;
+        case DataType::Int32:   ImageIO::store_inline<ValueType,int32_t>  (val, data, i, offset, scale); return;
+        case DataType::UInt32:  ImageIO::store_inline<ValueType,uint32_t> (val, data, i, offset, scale); return;
+        case DataType::Float32: ImageIO::store_inline<ValueType,float>    (val, data, i, offset, scale); return;
+        case DataType::Float64: ImageIO::store_inline<ValueType,double>   (val, data, i, offset, scale); return;
+        default:                store_func (val, data, i, offset, scale);
+      }
+    }
+
+  template <typename ValueType>
+    FORCE_INLINE typename std::enable_if<!is_data_type<ValueType>::value, void>::type __store_value (
+        uint8_t /*type*/, void (*store_func) (ValueType,void*,size_t,default_type,default_type),
+        ValueType val, void* data, size_t i, default_type offset, default_type scale) {
+      store_func (val, data, i, offset, scale);
+    }
+
+
 
   template <typename ValueType>
     typename std::enable_if<!is_data_type<ValueType>::value, void>::type __set_fetch_store_functions (
-        std::function<ValueType(const void*,size_t,default_type,default_type)>& /*fetch_func*/,
-        std::function<void(ValueType,void*,size_t,default_type,default_type)>& /*store_func*/, 
+        ValueType (*&/*fetch_func*/) (const void*,size_t,default_type,default_type),
+        void (*&/*store_func*/) (ValueType,void*,size_t,default_type,default_type), 
         DataType /*datatype*/) { }
 
 
 
   template <typename ValueType>
     typename std::enable_if<is_data_type<ValueType>::value, void>::type __set_fetch_store_functions (
-        std::function<ValueType(const void*,size_t,default_type,default_type)>& fetch_func,
-        std::function<void(ValueType,void*,size_t,default_type,default_type)>& store_func, 
+        ValueType (*&fetch_func) (const void*,size_t,default_type,default_type),
+        void (*&store_func) (ValueType,void*,size_t,default_type,default_type), 
+        DataType datatype);
+
+
+  //! bulk conversion functions, operating on \a count values separated by
+  //! \a stride elements, starting at offset \a i from \a data
+  template <typename ValueType>
+    typename std::enable_if<!is_data_type<ValueType>::value, void>::type __set_fetch_store_row_functions (
+        void (*&/*fetch_row_func*/) (ValueType*,const void*,size_t,ssize_t,size_t,default_type,default_type),
+        void (*&/*store_row_func*/) (const ValueType*,void*,size_t,ssize_t,size_t,default_type,default_type),
+        DataType /*datatype*/) { }
+
+  template <typename ValueType>
+    typename std::enable_if<is_data_type<ValueType>::value, void>::type __set_fetch_store_row_functions (
+        void (*&fetch_row_func) (ValueType*,const void*,size_t,ssize_t,size_t,default_type,default_type),
+        void (*&store_row_func) (const ValueType*,void*,size_t,ssize_t,size_t,default_type,default_type),
         DataType datatype);
 
 
@@ -42,8 +233,12 @@ namespace MR
   // to avoid massive recompile times...
 #define __DEFINE_FETCH_STORE_FUNCTION_FOR_TYPE(ValueType) \
   MRTRIX_EXTERN template void __set_fetch_store_functions<ValueType> ( \
-      std::function<ValueType(const void*,size_t,default_type,default_type)>& fetch_func, \
-        std::function<void(ValueType,void*,size_t,default_type,default_type)>& store_func, \
+      ValueType (*&fetch_func) (const void*,size_t,default_type,default_type), \
+        void (*&store_func) (ValueType,void*,size_t,default_type,default_type), \
+        DataType datatype); \
+  MRTRIX_EXTERN template void __set_fetch_store_row_functions<ValueType> ( \
+      void (*&fetch_row_func) (ValueType*,const void*,size_t,ssize_t,size_t,default_type,default_type), \
+        void (*&store_row_func) (const ValueType*,void*,size_t,ssize_t,size_t,default_type,default_type), \
         DataType datatype) 
 
 #define __DEFINE_FETCH_STORE_FUNCTIONS \
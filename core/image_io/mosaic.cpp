@@ -14,10 +14,12 @@
 
 
 #include <limits>
+#include <mutex>
 
 #include "app.h"
 #include "progressbar.h"
 #include "header.h"
+#include "thread_queue.h"
 #include "image_io/mosaic.h"
 
 namespace MR
@@ -43,26 +45,29 @@ namespace MR
       if (!addresses[0])
         throw Exception ("failed to allocate memory for image \"" + header.name() + "\"");
 
-      ProgressBar progress ("reformatting DICOM mosaic images", slices*files.size());
-      uint8_t* data = addresses[0].get();
-      for (size_t n = 0; n < files.size(); n++) {
-        File::MMap file (files[n], false, false, m_xdim * m_ydim * header.datatype().bytes());
-        size_t nx = 0, ny = 0;
+      // each file is unpacked independently, directly into its own segment
+      // of the output buffer:
+      const size_t bytes = header.datatype().bytes();
+      const size_t tiles_per_row = m_xdim / xdim;
+      std::mutex mutex;
+      ProgressBar progress ("reformatting DICOM mosaic images", files.size());
+      size_t next = 0;
+      auto loader = [&] (size_t& n) { n = next++; return n < files.size(); };
+      auto unpack = [&] (const size_t& n) {
+        File::MMap file (files[n], false, false, m_xdim * m_ydim * bytes);
+        uint8_t* data = addresses[0].get() + n * bytes_per_segment;
         for (size_t z = 0; z < slices; z++) {
-          size_t ox = nx*xdim;
-          size_t oy = ny*ydim;
+          const uint8_t* tile = file.address() + bytes * (xdim * (z % tiles_per_row) + m_xdim * ydim * (z / tiles_per_row));
           for (size_t y = 0; y < ydim; y++) {
-            memcpy (data, file.address() + header.datatype().bytes() * (ox + m_xdim* (y+oy)), xdim * header.datatype().bytes());
-            data += xdim * header.datatype().bytes();
+            memcpy (data, tile + bytes * m_xdim * y, xdim * bytes);
+            data += xdim * bytes;
           }
-          nx++;
-          if (nx >= m_xdim / xdim) {
-            nx = 0;
-            ny++;
-          }
-          ++progress;
         }
-      }
+        std::lock_guard<std::mutex> lock (mutex);
+        ++progress;
+        return true;
+      };
+      Thread::run_queue (loader, size_t(), Thread::multi (unpack));
 
       segsize = std::numeric_limits<size_t>::max();
     }
@@ -172,6 +172,17 @@ namespace MR
          *   { ... }
          * }
          * \endcode
+         *
+         * All interpolators also provide an overload that writes the
+         * interpolated values into an existing vector, which is resized only
+         * if necessary. When called repeatedly (e.g. once per voxel or per
+         * streamline vertex), this avoids any memory allocation, and the
+         * interpolation weights computed in voxel() are applied to all
+         * volumes in a single matrix-vector product:
+         *
+         * \code
+         * void row (Eigen::Matrix<value_type, Eigen::Dynamic, 1>& values, size_t axis);
+         * \endcode
          * */
 
 
@@ -181,16 +181,22 @@ namespace MR
         //! Read interpolated values from volumes along axis >= 3
         /*! See file interp/base.h for details. */
         Eigen::Matrix<value_type, Eigen::Dynamic, 1> row (size_t axis) {
+          Eigen::Matrix<value_type, Eigen::Dynamic, 1> values;
+          row (values, axis);
+          return values;
+        }
+
+        //! Read interpolated values from volumes along axis >= 3 into \a values
+        /*! See file interp/base.h for details. */
+        void row (Eigen::Matrix<value_type, Eigen::Dynamic, 1>& values, size_t axis) {
           if (Base<ImageType>::out_of_bounds) {
-            Eigen::Matrix<value_type, Eigen::Dynamic, 1> out_of_bounds_row (ImageType::size(axis));
-            out_of_bounds_row.setOnes();
-            out_of_bounds_row *= Base<ImageType>::out_of_bounds_value;
-            return out_of_bounds_row;
+            values.setConstant (ImageType::size(axis), Base<ImageType>::out_of_bounds_value);
+            return;
           }
 
           ssize_t c[] = { ssize_t (std::floor (P[0])-1), ssize_t (std::floor (P[1])-1), ssize_t (std::floor (P[2])-1) };
 
-          Eigen::Matrix<value_type, Eigen::Dynamic, 64> coeff_matrix ( ImageType::size(3), 64 );
+          coeff_matrix.resize (ImageType::size(axis), 64);
 
           size_t i(0);
           for (ssize_t z = 0; z < 4; ++z) {
@@ -204,11 +210,12 @@ namespace MR
             }
           }
 
-          return coeff_matrix * weights_vec;
+          values.noalias() = coeff_matrix * weights_vec;
         }
 
       protected:
         Eigen::Matrix<value_type, 64, 1> weights_vec;
+        Eigen::Matrix<value_type, Eigen::Dynamic, 64> coeff_matrix;
     };
 
 
@@ -324,7 +331,7 @@ namespace MR
 
           ssize_t c[] = { ssize_t (std::floor (P[0])-1), ssize_t (std::floor (P[1])-1), ssize_t (std::floor (P[2])-1) };
 
-          Eigen::Matrix<value_type, Eigen::Dynamic, 64> coeff_matrix (ImageType::size(3), 64);
+          coeff_matrix.resize (ImageType::size(3), 64);
 
           size_t i(0);
           for (ssize_t z = 0; z < 4; ++z) {
@@ -352,6 +359,7 @@ namespace MR
         Eigen::Matrix<value_type, Eigen::Dynamic, 3> out_of_bounds_matrix;
         Eigen::Matrix<value_type, 64, 3> weights_matrix;
         const Eigen::Matrix<default_type, 3, 3> wrt_scanner_transform;
+        Eigen::Matrix<value_type, Eigen::Dynamic, 64> coeff_matrix;
 
       private:
         Eigen::Matrix<value_type, Eigen::Dynamic, 1> row() { }
@@ -481,7 +489,7 @@ namespace MR
 
           ssize_t c[] = { ssize_t (std::floor (P[0])-1), ssize_t (std::floor (P[1])-1), ssize_t (std::floor (P[2])-1) };
 
-          Eigen::Matrix<value_type, Eigen::Dynamic, 64> coeff_matrix (ImageType::size(3), 64);
+          coeff_matrix.resize (ImageType::size(3), 64);
 
           size_t i(0);
           for (ssize_t z = 0; z < 4; ++z) {
@@ -494,7 +502,7 @@ namespace MR
               }
             }
           }
-          Eigen::Matrix<value_type, Eigen::Dynamic, 4> grad_and_value (coeff_matrix * weights_matrix);
+          grad_and_value.noalias() = coeff_matrix * weights_matrix;
           gradient = grad_and_value.block(0,0,ImageType::size(3),3);
           value = grad_and_value.col(3);
         }
@@ -512,6 +520,8 @@ namespace MR
         const Eigen::Matrix<default_type, 3, 3> wrt_scanner_transform;
         Eigen::Matrix<value_type, Eigen::Dynamic, 1> out_of_bounds_vec;
         Eigen::Matrix<value_type, Eigen::Dynamic, 3> out_of_bounds_matrix;
+        Eigen::Matrix<value_type, Eigen::Dynamic, 64> coeff_matrix;
+        Eigen::Matrix<value_type, Eigen::Dynamic, 4> grad_and_value;
     };
 
 
@@ -218,16 +218,22 @@ namespace MR
         //! Read interpolated values from volumes along axis >= 3
         /*! See file interp/base.h for details. */
         Eigen::Matrix<value_type, Eigen::Dynamic, 1> row (size_t axis) {
+          Eigen::Matrix<value_type, Eigen::Dynamic, 1> values;
+          row (values, axis);
+          return values;
+        }
+
+        //! Read interpolated values from volumes along axis >= 3 into \a values
+        /*! See file interp/base.h for details. */
+        void row (Eigen::Matrix<value_type, Eigen::Dynamic, 1>& values, size_t axis) {
           if (Base<ImageType>::out_of_bounds) {
-            Eigen::Matrix<value_type, Eigen::Dynamic, 1> out_of_bounds_row (ImageType::size(axis));
-            out_of_bounds_row.setOnes();
-            out_of_bounds_row *= Base<ImageType>::out_of_bounds_value;
-            return out_of_bounds_row;
+            values.setConstant (ImageType::size(axis), Base<ImageType>::out_of_bounds_value);
+            return;
           }
 
           ssize_t c[] = { ssize_t (std::floor (P[0])), ssize_t (std::floor (P[1])), ssize_t (std::floor (P[2])) };
 
-          Eigen::Matrix<value_type, Eigen::Dynamic, 8> coeff_matrix ( ImageType::size(3), 8 );
+          coeff_matrix.resize (ImageType::size(axis), 8);
 
           size_t i(0);
           for (ssize_t z = 0; z < 2; ++z) {
@@ -241,11 +247,12 @@ namespace MR
             }
           }
 
-          return coeff_matrix * factors;
+          values.noalias() = coeff_matrix * factors;
         }
 
       protected:
         Eigen::Matrix<coef_type, 8, 1> factors;
+        Eigen::Matrix<value_type, Eigen::Dynamic, 8> coeff_matrix;
     };
 
 
@@ -368,7 +375,7 @@ namespace MR
 
           ssize_t c[] = { ssize_t (std::floor (P[0])), ssize_t (std::floor (P[1])), ssize_t (std::floor (P[2])) };
 
-          Eigen::Matrix<value_type, Eigen::Dynamic, 8> coeff_matrix (ImageType::size(3), 8);
+          coeff_matrix.resize (ImageType::size(3), 8);
 
           size_t i(0);
           for (ssize_t z = 0; z < 2; ++z) {
@@ -395,6 +402,7 @@ namespace MR
         const Eigen::Matrix<coef_type, 1, 3> out_of_bounds_vec;
         Eigen::Matrix<coef_type, 8, 3> weights_matrix;
         const Eigen::Matrix<default_type, 3, 3> wrt_scanner_transform;
+        Eigen::Matrix<value_type, Eigen::Dynamic, 8> coeff_matrix;
     };
 
 
@@ -540,7 +548,7 @@ namespace MR
 
           ssize_t c[] = { ssize_t (std::floor (P[0])), ssize_t (std::floor (P[1])), ssize_t (std::floor (P[2])) };
 
-          Eigen::Matrix<value_type, Eigen::Dynamic, 8> coeff_matrix (ImageType::size(3), 8);
+          coeff_matrix.resize (ImageType::size(3), 8);
 
           size_t i(0);
           for (ssize_t z = 0; z < 2; ++z) {
@@ -554,7 +562,7 @@ namespace MR
             }
           }
 
-          Eigen::Matrix<value_type, Eigen::Dynamic, 4> grad_and_value (coeff_matrix * weights_matrix);
+          grad_and_value.noalias() = coeff_matrix * weights_matrix;
           gradient = grad_and_value.block(0, 0, ImageType::size(3), 3);
           value = grad_and_value.col(3);
         }
@@ -574,6 +582,8 @@ namespace MR
         Eigen::Matrix<value_type, 8, 4> weights_matrix;
         Eigen::Matrix<coef_type, Eigen::Dynamic, 1> out_of_bounds_vec;
         Eigen::Matrix<coef_type, Eigen::Dynamic, 3> out_of_bounds_matrix;
+        Eigen::Matrix<value_type, Eigen::Dynamic, 8> coeff_matrix;
+        Eigen::Matrix<value_type, Eigen::Dynamic, 4> grad_and_value;
 
     };
 
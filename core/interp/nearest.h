@@ -124,6 +124,17 @@ namespace MR
           return ImageType::row(axis);
         }
 
+        //! Read interpolated values from volumes along axis >= 3 into \a values
+        /*! See file interp/base.h for details. */
+        void row (Eigen::Matrix<value_type, Eigen::Dynamic, 1>& values, size_t axis) {
+          assert (axis > 2);
+          assert (axis < ImageType::ndim());
+          if (out_of_bounds)
+            values.setConstant (ImageType::size(axis), out_of_bounds_value);
+          else
+            values = ImageType::row(axis);
+        }
+
     };
 
 
@@ -133,23 +133,28 @@ namespace MR
         //! Read interpolated values from volumes along axis >= 3
         /*! See file interp/base.h for details. */
         Eigen::Matrix<value_type, Eigen::Dynamic, 1> row (size_t axis) {
+          Eigen::Matrix<value_type, Eigen::Dynamic, 1> values;
+          row (values, axis);
+          return values;
+        }
+
+        //! Read interpolated values from volumes along axis >= 3 into \a values
+        /*! See file interp/base.h for details. */
+        void row (Eigen::Matrix<value_type, Eigen::Dynamic, 1>& values, size_t axis) {
           assert (axis > 2);
           assert (axis < ImageType::ndim());
           if (out_of_bounds) {
-            Eigen::Matrix<value_type, Eigen::Dynamic, 1> out_of_bounds_row (ImageType::size(axis));
-            out_of_bounds_row.setOnes();
-            out_of_bounds_row *= out_of_bounds_value;
-            return out_of_bounds_row;
+            values.setConstant (ImageType::size(axis), out_of_bounds_value);
+            return;
           }
 
-          Eigen::Matrix<value_type, Eigen::Dynamic, 1> row (ImageType::size(axis));
+          values.resize (ImageType::size(axis));
           // Lazy, non-optimized code, since nothing is actually using this yet
           // Just make use of the kernel setup within voxel()
           for (ssize_t volume = 0; volume != ImageType::size(axis); ++volume) {
             ImageType::index (axis) = volume;
-            row (volume,0) = value();
+            values[volume] = value();
           }
-          return row;
         }
 
 
@@ -456,13 +456,18 @@ namespace MR
        * to operate directly in spherical coordinates. The initial search
        * direction is \a unit_init_dir. If \a precomputer is not nullptr, it
        * will be used to speed up the calculations, at the cost of a minor
-       * reduction in accuracy. */
+       * reduction in accuracy. If \a init_derivatives is not nullptr, it
+       * should point to the amplitude and derivatives of the SH series at
+       * \a unit_init_dir (in the order computed by derivatives(), as provided
+       * by DerivativesTransform); these are then used in the first
+       * iteration rather than being computed. */
       template <class VectorType, class UnitVectorType, class ValueType = float>
         inline typename VectorType::Scalar get_peak (
             const VectorType& sh,
             int lmax,
             UnitVectorType& unit_init_dir,
-            PrecomputedAL<typename VectorType::Scalar>* precomputer = nullptr)
+            PrecomputedAL<typename VectorType::Scalar>* precomputer = nullptr,
+            const typename VectorType::Scalar* init_derivatives = nullptr)
         {
           using value_type = typename VectorType::Scalar;
           assert (std::isfinite (unit_init_dir[0]));
@@ -470,7 +475,16 @@ namespace MR
             value_type az = std::atan2 (unit_init_dir[1], unit_init_dir[0]);
             value_type el = std::acos (unit_init_dir[2]);
             value_type amplitude, dSH_del, dSH_daz, d2SH_del2, d2SH_deldaz, d2SH_daz2;
-            derivatives (sh, lmax, el, az, amplitude, dSH_del, dSH_daz, d2SH_del2, d2SH_deldaz, d2SH_daz2, precomputer);
+            if (init_derivatives && !i) {
+              amplitude   = init_derivatives[0];
+              dSH_del     = init_derivatives[1];
+              dSH_daz     = init_derivatives[2];
+              d2SH_del2   = init_derivatives[3];
+              d2SH_deldaz = init_derivatives[4];
+              d2SH_daz2   = init_derivatives[5];
+            } else {
+              derivatives (sh, lmax, el, az, amplitude, dSH_del, dSH_daz, d2SH_del2, d2SH_deldaz, d2SH_daz2, precomputer);
+            }
 
             value_type del = sqrt (dSH_del*dSH_del + dSH_daz*dSH_daz);
             value_type daz = 0.0;
@@ -594,6 +608,64 @@ namespace MR
 
 
 
+      //! amplitudes & derivatives of SH series on a fixed set of directions
+      /*! The amplitude and the first & second derivatives of an SH series (as
+       * computed by derivatives()) are linear in the SH coefficients. This
+       * class pre-computes the corresponding basis for a set of unit
+       * direction vectors (one per row of \a unit_dirs), so that these can
+       * be evaluated for many SH series at once (e.g. for all voxels in a
+       * block of an image, stored as the columns of a matrix) as a single
+       * matrix product.
+       *
+       * For direction \c d, rows <tt>6d</tt> to <tt>6d+5</tt> of the output
+       * contain the amplitude, dSH_del, dSH_daz, d2SH_del2, d2SH_deldaz &
+       * d2SH_daz2 respectively; with a column-major output, a pointer to
+       * these can be passed directly to get_peak(). */
+      template <typename ValueType>
+      class DerivativesTransform { MEMALIGN(DerivativesTransform<ValueType>)
+        public:
+          using matrix_type = Eigen::Matrix<ValueType,Eigen::Dynamic,Eigen::Dynamic>;
+          using vector_type = Eigen::Matrix<ValueType,Eigen::Dynamic,1>;
+
+          template <class MatrixType>
+            DerivativesTransform (const MatrixType& unit_dirs, int lmax) :
+              D (6 * unit_dirs.rows(), NforL (lmax))
+          {
+            vector_type sh (vector_type::Zero (D.cols()));
+            for (ssize_t d = 0; d != unit_dirs.rows(); ++d) {
+              // computed as in get_peak():
+              const ValueType az = std::atan2 (ValueType (unit_dirs (d,1)), ValueType (unit_dirs (d,0)));
+              const ValueType el = std::acos (ValueType (unit_dirs (d,2)));
+              for (ssize_t n = 0; n != D.cols(); ++n) {
+                sh[n] = ValueType(1);
+                derivatives (sh, lmax, el, az, D(6*d,n), D(6*d+1,n), D(6*d+2,n), D(6*d+3,n), D(6*d+4,n), D(6*d+5,n), nullptr);
+                sh[n] = ValueType(0);
+              }
+            }
+          }
+
+          template <class MatrixType1, class MatrixType2>
+            void operator() (MatrixType1& derivs, const MatrixType2& sh) const {
+              derivs.noalias() = D * sh;
+            }
+
+          size_t n_SH () const {
+            return D.cols();
+          }
+          size_t n_dirs () const {
+            return D.rows() / 6;
+          }
+
+          const matrix_type& mat () const {
+            return D;
+          }
+
+        protected:
+          matrix_type D;
+      };
+
+
+
       //! a class to hold the coefficients for an apodised point-spread function.
       template <typename ValueType> class aPSF
       { MEMALIGN(aPSF<ValueType>)
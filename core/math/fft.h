@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2008-2018 the MRtrix3 contributors.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at http://mozilla.org/MPL/2.0/
+ *
+ * MRtrix3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * For more details, see http://www.mrtrix.org/
+ */
+
+
+#ifndef __math_fft_h__
+#define __math_fft_h__
+
+#include <complex>
+
+#if defined(MRTRIX_FFTW_SUPPORT) || defined(MRTRIX_FFTWF_SUPPORT)
+# include <map>
+# include <mutex>
+# include <tuple>
+# include <fftw3.h>
+#endif
+
+#include <unsupported/Eigen/FFT>
+
+#include "types.h"
+#include "exception.h"
+
+namespace MR
+{
+  namespace Math
+  {
+
+    /** @addtogroup fft Fast Fourier transform
+      @{ */
+
+    namespace FFT_backend
+    {
+
+      //! the portable backend: Eigen's bundled KISS FFT
+      /*! Lines are gathered into a contiguous buffer, transformed, and
+       * scattered back; the twiddle factors for the requested length are
+       * computed once on construction. */
+      template <typename ValueType>
+        class KISS { MEMALIGN(KISS<ValueType>)
+          public:
+            using complex_type = std::complex<ValueType>;
+            using fft_type = Eigen::FFT<ValueType, Eigen::internal::kissfft_impl<ValueType>>;
+
+            KISS (const size_t size, const bool inverse) :
+                in (size),
+                out (size),
+                inverse (inverse) {
+                  fft.SetFlag (fft_type::Unscaled);
+                  // force creation of the plan now, rather than on first use
+                  // (a transform of length 1 is the identity, which KISS FFT
+                  // does not handle):
+                  if (size > 1)
+                    transform();
+                }
+
+            void operator() (complex_type* data, const size_t count, const ssize_t stride, const ssize_t distance)
+            {
+              const ssize_t n = in.size();
+              for (size_t l = 0; l != count; ++l, data += distance) {
+                for (ssize_t i = 0; i != n; ++i)
+                  in[i] = data[i*stride];
+                transform();
+                for (ssize_t i = 0; i != n; ++i)
+                  data[i*stride] = out[i];
+              }
+            }
+
+          protected:
+            fft_type fft;
+            vector<complex_type> in, out;
+            const bool inverse;
+
+            void transform () {
+              if (inverse)
+                fft.inv (out.data(), in.data(), in.size());
+              else
+                fft.fwd (out.data(), in.data(), in.size());
+            }
+        };
+
+
+
+#if defined(MRTRIX_FFTW_SUPPORT) || defined(MRTRIX_FFTWF_SUPPORT)
+
+      template <typename ValueType> struct FFTWTraits { NOMEMALIGN };
+
+#ifdef MRTRIX_FFTW_SUPPORT
+      template <> struct FFTWTraits<double> { NOMEMALIGN
+        using plan_type = fftw_plan;
+        using complex_type = fftw_complex;
+        static plan_type plan (int n, int count, complex_type* data, int stride, int distance, int sign) {
+          return fftw_plan_many_dft (1, &n, count, data, nullptr, stride, distance, data, nullptr, stride, distance, sign, FFTW_ESTIMATE | FFTW_UNALIGNED);
+        }
+        static void execute (const plan_type p, complex_type* data) { fftw_execute_dft (p, data, data); }
+      };
+#endif
+
+#ifdef MRTRIX_FFTWF_SUPPORT
+      template <> struct FFTWTraits<float> { NOMEMALIGN
+        using plan_type = fftwf_plan;
+        using complex_type = fftwf_complex;
+        static plan_type plan (int n, int count, complex_type* data, int stride, int distance, int sign) {
+          return fftwf_plan_many_dft (1, &n, count, data, nullptr, stride, distance, data, nullptr, stride, distance, sign, FFTW_ESTIMATE | FFTW_UNALIGNED);
+        }
+        static void execute (const plan_type p, complex_type* data) { fftwf_execute_dft (p, data, data); }
+      };
+#endif
+
+
+
+      //! the FFTW backend
+      /*! Plans are created for the complete batch of lines, and cached
+       * process-wide: since FFTW's planner is not thread-safe, plan creation
+       * is serialised, while execution (which is thread-safe) is not. Plans
+       * are created with FFTW_UNALIGNED so that they can be executed on any
+       * array with matching layout. */
+      template <typename ValueType>
+        class FFTW { MEMALIGN(FFTW<ValueType>)
+          public:
+            using complex_type = std::complex<ValueType>;
+            using traits = FFTWTraits<ValueType>;
+
+            FFTW (const size_t size, const bool inverse) :
+                size (size),
+                inverse (inverse) { }
+
+            void operator() (complex_type* data, const size_t count, const ssize_t stride, const ssize_t distance)
+            {
+              traits::execute (get_plan (data, count, stride, distance), reinterpret_cast<typename traits::complex_type*> (data));
+            }
+
+          protected:
+            using key_type = std::tuple<size_t, size_t, ssize_t, ssize_t, bool>;
+            const size_t size;
+            const bool inverse;
+            key_type last_key;
+            typename traits::plan_type last_plan = nullptr;
+
+            typename traits::plan_type get_plan (complex_type* data, const size_t count, const ssize_t stride, const ssize_t distance)
+            {
+              const key_type key (size, count, stride, distance, inverse);
+              if (last_plan && key == last_key)
+                return last_plan;
+              static std::map<key_type, typename traits::plan_type> plans;
+              static std::mutex mutex;
+              std::lock_guard<std::mutex> lock (mutex);
+              auto& p = plans[key];
+              // FFTW_ESTIMATE planning does not modify the contents of the array:
+              if (!p)
+                p = traits::plan (size, count, reinterpret_cast<typename traits::complex_type*> (data), stride, distance, inverse ? FFTW_BACKWARD : FFTW_FORWARD);
+              if (!p)
+                throw Exception ("error creating FFTW plan");
+              last_key = key;
+              last_plan = p;
+              return p;
+            }
+        };
+
+#endif
+
+
+
+      template <typename ValueType> struct Select { NOMEMALIGN using type = KISS<ValueType>; };
+#ifdef MRTRIX_FFTW_SUPPORT
+      template <> struct Select<double> { NOMEMALIGN using type = FFTW<double>; };
+#endif
+#ifdef MRTRIX_FFTWF_SUPPORT
+      template <> struct Select<float> { NOMEMALIGN using type = FFTW<float>; };
+#endif
+
+    }
+
+
+
+    //! one-dimensional complex FFT of fixed length, applied to batches of lines
+    /*! This uses FFTW where MRtrix3 was configured with it (for double
+     * precision, and for single precision if libfftw3f was also found), and
+     * Eigen's bundled KISS FFT otherwise.
+     *
+     * As for Eigen::FFT, the inverse transform is scaled by 1/N, so that
+     * the inverse of the forward transform recovers the original data.
+     *
+     * Transforms are performed in place, on \a count lines of \a size
+     * elements, where element \c i of line \c l is located at
+     * <tt>data[l*distance + i*stride]</tt>. An instance must not be used
+     * concurrently by multiple threads; each thread should hold its own
+     * copy (plans are nevertheless shared across instances where possible).
+     *
+     * Typical usage, to transform all columns of a column-major matrix:
+     * \code
+     * Math::FFT<double> fft (M.rows(), false);
+     * fft (M.data(), M.cols(), 1, M.outerStride());
+     * \endcode */
+    template <typename ValueType>
+      class FFT { MEMALIGN(FFT<ValueType>)
+        public:
+          using complex_type = std::complex<ValueType>;
+
+          FFT (const size_t size, const bool inverse) :
+              N (size),
+              inverse (inverse),
+              impl (size, inverse) { }
+
+          size_t size () const { return N; }
+
+          void operator() (complex_type* data, const size_t count = 1, const ssize_t stride = 1, ssize_t distance = 0)
+          {
+            if (N < 2)
+              return;
+            if (!distance)
+              distance = N * stride;
+            impl (data, count, stride, distance);
+            if (inverse) {
+              const ValueType scale = ValueType(1) / ValueType(N);
+              for (ssize_t l = 0; l != ssize_t(count); ++l)
+                for (ssize_t i = 0; i != ssize_t(N); ++i)
+                  data[l*distance + i*stride] *= scale;
+            }
+          }
+
+          //! transform all rows of a (column-major) matrix
+          template <class MatrixType>
+            void rows (MatrixType& M) {
+              assert (size_t(M.cols()) == N);
+              (*this) (M.data(), M.rows(), M.outerStride(), 1);
+            }
+
+          //! transform all columns of a (column-major) matrix
+          template <class MatrixType>
+            void cols (MatrixType& M) {
+              assert (size_t(M.rows()) == N);
+              (*this) (M.data(), M.cols(), 1, M.outerStride());
+            }
+
+        protected:
+          const size_t N;
+          const bool inverse;
+          typename FFT_backend::Select<ValueType>::type impl;
+      };
+
+    /** @} */
+
+  }
+}
+
+#endif
@@ -61,6 +61,17 @@ namespace MR
           }
         }
 
+        //! merge statistics accumulated separately (e.g. by another thread)
+        Stats& operator+= (const Stats& other) {
+          mean += other.mean;
+          std += other.std;
+          min = complex_type (std::min (min.real(), other.min.real()), std::min (min.imag(), other.min.imag()));
+          max = complex_type (std::max (max.real(), other.max.real()), std::max (max.imag(), other.max.imag()));
+          count += other.count;
+          values.insert (values.end(), other.values.begin(), other.values.end());
+          return *this;
+        }
+
         template <class ImageType> void print (ImageType& ima, const vector<std::string>& fields) {
 
           if (count) {
@@ -0,0 +1,7 @@
+
+namespace MR {
+  namespace App {
+    const char* mrtrix_version = "76324ea7";
+    const char* build_date = __DATE__;
+  }
+}
@@ -0,0 +1 @@
+__version__ = "76324ea7"
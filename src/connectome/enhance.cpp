@@ -16,9 +16,6 @@
 #include "connectome/enhance.h"
 #include "connectome/mat2vec.h"
 
-#include <set>
-
-#include "progressbar.h"
 
 
 namespace MR {
@@ -37,67 +34,67 @@ namespace MR {
 
       value_type NBS::operator() (const vector_type& in, const value_type T, vector_type& out) const
       {
+        assert (size_t(in.size()) == edges->size());
         out = vector_type::Zero (in.size());
-        value_type max_value = value_type(0);
-
-        for (ssize_t seed = 0; seed != in.size(); ++seed) {
-          if (std::isfinite (in[seed]) && in[seed] >= T && !out[seed]) {
-
-            BitSet visited (in.size());
-            visited[seed] = true;
-            vector<size_t> to_expand (1, seed);
-            size_t cluster_size = 0;
-
-            while (to_expand.size()) {
-
-              const uint32_t index = to_expand.back();
-              to_expand.pop_back();
-              cluster_size++;
-
-              for (vector<size_t>::const_iterator i = (*adjacency)[index].begin(); i != (*adjacency)[index].end(); ++i) {
-                if (!visited[*i] && std::isfinite(in[*i]) && in[*i] >= T) {
-                  visited[*i] = true;
-                  to_expand.push_back (*i);
-                }
-              }
 
-            }
-
-            max_value = std::max (max_value, value_type(cluster_size));
-            for (ssize_t i = 0; i != in.size(); ++i)
-              out[i] += (visited[i] ? 1.0 : 0.0) * cluster_size;
+        // Clusters of edges are found as connected components of the graph
+        //   formed by the supra-threshold edges, using union-find over nodes;
+        //   each root is the lowest node index within its component
+        vector<node_t> parent (num_nodes);
+        for (node_t n = 0; n != num_nodes; ++n)
+          parent[n] = n;
+        auto find_root = [&] (node_t n) {
+          while (parent[n] != n) {
+            parent[n] = parent[parent[n]];
+            n = parent[n];
+          }
+          return n;
+        };
+
+        bool any = false;
+        for (ssize_t edge = 0; edge != in.size(); ++edge) {
+          if (std::isfinite (in[edge]) && in[edge] >= T) {
+            any = true;
+            const node_t a = find_root ((*edges)[edge].first);
+            const node_t b = find_root ((*edges)[edge].second);
+            if (a < b)
+              parent[b] = a;
+            else if (b < a)
+              parent[a] = b;
+          }
+        }
+        if (!any)
+          return value_type(0);
+
+        // Cluster size is the number of supra-threshold edges in the component
+        vector<size_t> cluster_sizes (num_nodes, 0);
+        for (ssize_t edge = 0; edge != in.size(); ++edge) {
+          if (std::isfinite (in[edge]) && in[edge] >= T)
+            ++cluster_sizes[find_root ((*edges)[edge].first)];
+        }
 
+        size_t max_size = 0;
+        for (ssize_t edge = 0; edge != in.size(); ++edge) {
+          if (std::isfinite (in[edge]) && in[edge] >= T) {
+            const size_t cluster_size = cluster_sizes[find_root ((*edges)[edge].first)];
+            out[edge] = value_type(cluster_size);
+            max_size = std::max (max_size, cluster_size);
           }
         }
 
-        return max_value;
+        return value_type(max_size);
       }
 
 
 
-      void NBS::initialise (const node_t num_nodes)
+      void NBS::initialise (const node_t nodes)
       {
+        num_nodes = nodes;
         const Mat2Vec mat2vec (num_nodes);
-        const size_t num_edges = mat2vec.vec_size();
-        ProgressBar progress ("Pre-computing statistical correlation matrix...", num_edges);
-        adjacency.reset (new vector< vector<size_t> > (num_edges, vector<size_t>()));
+        edges.reset (new vector< std::pair<node_t, node_t> > (mat2vec.vec_size()));
         for (node_t row = 0; row != num_nodes; ++row) {
-          for (node_t column = row; column != num_nodes; ++column) {
-
-            const size_t index = mat2vec (row, column);
-            vector<size_t>& vector = (*adjacency)[index];
-            vector.reserve (2 * (num_nodes-1));
-            // Should be able to expand from this edge to any other edge connected to either row or column
-            for (node_t r = 0; r != num_nodes; ++r) {
-              if (r != row)
-                vector.push_back (mat2vec (r, column));
-            }
-            for (node_t c = 0; c != num_nodes; ++c) {
-              if (c != column)
-                vector.push_back (mat2vec (row, c));
-            }
-            ++progress;
-          }
+          for (node_t column = row; column != num_nodes; ++column)
+            (*edges)[mat2vec (row, column)] = std::make_pair (row, column);
         }
       }
 
@@ -19,7 +19,6 @@
 #include <memory>
 #include <stdint.h>
 
-#include "bitset.h"
 #include "types.h"
 
 #include "connectome/mat2vec.h"
@@ -72,7 +71,10 @@ namespace MR {
           value_type operator() (const vector_type&, const value_type, vector_type&) const override;
 
         protected:
-          std::shared_ptr< vector< vector<size_t> > > adjacency;
+          // The two nodes connected by each edge; supra-threshold edges that
+          //   share a node belong to the same cluster
+          std::shared_ptr< vector< std::pair<node_t, node_t> > > edges;
+          node_t num_nodes;
           value_type threshold;
 
         private:
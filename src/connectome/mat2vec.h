@@ -51,8 +51,8 @@ namespace MR {
 
         std::pair<node_t, node_t> operator() (const uint64_t i) const
         {
-          static const uint64_t temp = 2*dim+1;
-          static const uint64_t temp_sq = temp * temp;
+          const uint64_t temp = 2*dim+1;
+          const uint64_t temp_sq = temp * temp;
           const uint64_t row = std::floor ((temp - std::sqrt(temp_sq - (8*i))) / 2);
           const uint64_t col = i - (uint64_t(dim)*row) + ((row * (row+1))/2);
           assert (row < dim);
@@ -33,7 +33,10 @@ namespace MR
 
 
 
-      MT_gradient_vector_sorter::MT_gradient_vector_sorter (MT_gradient_vector_sorter::VecType& in, const track_t block_size)
+      MT_gradient_vector_sorter::MT_gradient_vector_sorter (MT_gradient_vector_sorter::VecType& in, const track_t block_size) :
+          begin (in.begin()),
+          end (in.end()),
+          block_size (block_size)
       {
         BlockSender source (in.size(), block_size);
         Sorter      pipe   (in);
@@ -45,11 +48,17 @@ namespace MR
 
       MT_gradient_vector_sorter::VecItType MT_gradient_vector_sorter::get()
       {
+        assert (!candidates.empty());
         VecItType return_iterator (*candidates.begin());
         VecItType incremented (*candidates.begin());
         ++incremented;
         candidates.erase (candidates.begin());
-        candidates.insert (incremented);
+        // If every gradient in the block is negative, the incremented iterator reaches the end of
+        //   the block, i.e. either the end of the data or the start of the next block; neither
+        //   must be re-inserted
+        const track_t block_end = std::min (track_t (((return_iterator - begin) / block_size + 1) * block_size), track_t (end - begin));
+        if (incremented != begin + block_end)
+          candidates.insert (incremented);
         return return_iterator;
       }
 
@@ -77,7 +77,8 @@ namespace MR
       //     The entry in the set corresponding to the gradient vector is removed, but the iterator WITHIN THE BLOCK
       //     is incremented and re-written to the set; this allows multiple streamlines from a single block to
       //     be filtered in a single iteration, provided the gradient is less than that of the candidate streamline
-      //     from all other blocks
+      //     from all other blocks; once the end of a block is reached, that block no longer provides candidates,
+      //     and once all blocks are exhausted, empty() returns true and get() must not be called
       class MT_gradient_vector_sorter
       { MEMALIGN(MT_gradient_vector_sorter)
 
@@ -95,6 +96,7 @@ namespace MR
           MT_gradient_vector_sorter (VecType& in, const track_t);
 
           VecItType get();
+          bool empty() const { return candidates.empty(); }
 
           bool operator() (const VecItType& in)
           {
@@ -105,6 +107,8 @@ namespace MR
 
         private:
           SetType candidates;
+          const VecItType begin, end;
+          const track_t block_size;
 
 
           class BlockSender
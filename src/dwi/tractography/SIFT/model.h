@@ -70,8 +70,6 @@ namespace MR
           }
           Model (const Model& that) = delete;
 
-          virtual ~Model ();
-
 
           // Over-rides the function defined in ModelBase; need to build contributions member also
           void map_streamlines (const std::string&);
@@ -91,7 +89,8 @@ namespace MR
 
         protected:
           std::string tck_file_path;
-          vector<TrackContribution*> contributions;
+          TrackContributionArena contribution_arena;
+          vector<TrackContribution> contributions;
 
           using Fixel_map<Fixel>::accessor;
           using Fixel_map<Fixel>::begin;
@@ -151,20 +150,6 @@ namespace MR
 
 
 
-      template <class Fixel>
-      Model<Fixel>::~Model ()
-      {
-        for (vector<TrackContribution*>::iterator i = contributions.begin(); i != contributions.end(); ++i) {
-          if (*i) {
-            delete *i;
-            *i = nullptr;
-          }
-        }
-      }
-
-
-
-
       template <class Fixel>
       void Model<Fixel>::map_streamlines (const std::string& path)
       {
@@ -175,7 +160,7 @@ namespace MR
         if (!count)
           throw Exception ("Cannot map streamlines: track file " + Path::basename(path) + " is empty");
 
-        contributions.assign (count, nullptr);
+        contributions.assign (count, TrackContribution());
 
         {
           Mapping::TrackLoader loader (file, count);
@@ -199,6 +184,7 @@ namespace MR
 
         tck_file_path = path;
 
+        INFO ("Streamline contributions occupy " + str (contribution_arena.size()) + " fixel entries");
         INFO ("Proportionality coefficient after streamline mapping is " + str (mu()));
       }
 
@@ -281,9 +267,9 @@ namespace MR
         VAR (sum_from_fixels);
         VAR (sum_from_fixels_weighted);
         double sum_from_tracks = 0.0;
-        for (vector<TrackContribution*>::const_iterator i = contributions.begin(); i != contributions.end(); ++i) {
-          if (*i)
-            sum_from_tracks += (*i)->get_total_contribution();
+        for (const auto& i : contributions) {
+          if (i)
+            sum_from_tracks += i.get_total_contribution();
         }
         VAR (sum_from_tracks);
       }
@@ -302,7 +288,7 @@ namespace MR
         ProgressBar progress ("Writing non-contributing streamlines output file", contributions.size());
         track_t tck_counter = 0;
         while (reader (tck) && tck_counter < contributions.size()) {
-          if (contributions[tck_counter] && !contributions[tck_counter++]->get_total_contribution())
+          if (contributions[tck_counter] && !contributions[tck_counter++].get_total_contribution())
             writer (tck);
           else
             writer.skip();
@@ -358,7 +344,7 @@ namespace MR
             }
           }
 
-          master.contributions[in.index] = new TrackContribution (masked_contributions, total_contribution, total_length);
+          master.contributions[in.index] = master.contribution_arena.store (masked_contributions, total_contribution, total_length);
 
           TD_sum += total_contribution;
           for (vector<Track_fixel_contribution>::const_iterator i = masked_contributions.begin(); i != masked_contributions.end(); ++i)
@@ -380,20 +366,21 @@ namespace MR
       bool Model<Fixel>::FixelRemapper::operator() (const TrackIndexRange& in)
       {
         for (track_t track_index = in.first; track_index != in.second; ++track_index) {
-          if (master.contributions[track_index]) {
-            TrackContribution& this_cont (*master.contributions[track_index]);
-            vector<Track_fixel_contribution> new_cont;
+          TrackContribution& this_cont (master.contributions[track_index]);
+          if (this_cont) {
+            // Fixels can only be removed, so the remapped contributions can be
+            //   written in-place within the existing storage
+            size_t new_dim = 0;
             double total_contribution = 0.0;
             for (size_t i = 0; i != this_cont.dim(); ++i) {
               const size_t new_index = remapper[this_cont[i].get_fixel_index()];
               if (new_index) {
-                new_cont.push_back (Track_fixel_contribution (new_index, this_cont[i].get_length()));
-                total_contribution += this_cont[i].get_length() * master[new_index].get_weight();
+                const float length = this_cont[i].get_length();
+                this_cont[new_dim++] = Track_fixel_contribution (new_index, length);
+                total_contribution += length * master[new_index].get_weight();
               }
             }
-            TrackContribution* new_contribution = new TrackContribution (new_cont, total_contribution, this_cont.get_total_length());
-            delete master.contributions[track_index];
-            master.contributions[track_index] = new_contribution;
+            this_cont.truncate (new_dim, total_contribution);
           }
         }
         return true;
@@ -49,6 +49,16 @@ namespace MR
 
 
 
+// Maximum number of candidate streamlines for which the effect of removal is evaluated in advance
+#define SIFT_REMOVAL_BATCH_SIZE 4096
+// Number of candidates processed by each thread at a time within such a batch
+#define SIFT_REMOVAL_BATCH_CHUNK_SIZE 64
+// If fewer candidates than this were accepted in the previous iteration, the
+//   next one evaluates candidates serially until this many have been accepted
+#define SIFT_REMOVAL_BATCH_MIN_ACCEPTED 256
+
+
+
       void SIFTer::perform_filtering()
       {
 
@@ -59,10 +69,10 @@ namespace MR
         vector<track_t> noncontributing_indices;
         for (track_t i = 0; i != contributions.size(); ++i) {
           if (contributions[i]) {
-            if (contributions[i]->get_total_contribution()) {
-              sum_contributing_length    += contributions[i]->get_total_length();
+            if (contributions[i].get_total_contribution()) {
+              sum_contributing_length    += contributions[i].get_total_length();
             } else {
-              sum_noncontributing_length += contributions[i]->get_total_length();
+              sum_noncontributing_length += contributions[i].get_total_length();
               noncontributing_indices.push_back (i);
             }
           }
@@ -101,6 +111,20 @@ namespace MR
         bool another_iteration = true;
         recalc_reason recalculate (UNDEFINED);
 
+        // Candidate streamlines are drawn from the sorter in batches, so that the change in
+        //   cost function upon the removal of each can be calculated in parallel; the decision
+        //   on whether or not to remove each candidate is still made sequentially
+        // Once a candidate is rejected, the work done for the remainder of its batch is wasted;
+        //   each iteration therefore starts with a batch no larger than the number of
+        //   candidates accepted in the previous iteration, doubling it whenever a batch is
+        //   exhausted. If few candidates were accepted, the next iteration instead starts by
+        //   evaluating candidates serially, since the overhead of preparing batches would
+        //   outweigh any gain; it reverts to batches once enough candidates have been accepted.
+        const size_t max_batch_size = Thread::number_of_threads() > 1 ? SIFT_REMOVAL_BATCH_SIZE : 1;
+        size_t initial_batch_size = max_batch_size;
+        vector<RemovalCandidate> batch;
+        BitSet fixels_in_batch (fixels.size());
+
         do {
 
           ++iteration;
@@ -135,6 +159,8 @@ namespace MR
           // Remove candidate streamlines one at a time, and correspondingly modify the fixels to which they were attributed
           removed_this_iteration = 0;
           recalculate = UNDEFINED;
+          batch.clear();
+          size_t batch_position = 0, batch_size = initial_batch_size, accepted_this_iteration = 0;
           do {
 
             if (!output_at_counts.empty() && (tracks_remaining == output_at_counts.back())) {
@@ -168,19 +194,37 @@ namespace MR
               noncontributing_indices.pop_back();
 
               // Remove this streamline, and adjust all of the relevant quantities
-              noncontributing_length_removed += contributions[to_remove]->get_total_length();
-              delete contributions[to_remove];
-              contributions[to_remove] = nullptr;
+              noncontributing_length_removed += contributions[to_remove].get_total_length();
+              contributions[to_remove].erase();
               ++removed_this_iteration;
               --tracks_remaining;
 
             } else { // Proceed as normal
 
-              const vector<Cost_fn_gradient_sort>::iterator candidate = sorter.get();
+              if (batch_position == batch.size()) {
+                if (batch.size()) {
+                  if (batch_size > 1)
+                    batch_size = std::min (2 * batch_size, max_batch_size);
+                  else if (accepted_this_iteration >= SIFT_REMOVAL_BATCH_MIN_ACCEPTED)
+                    batch_size = std::min (size_t(SIFT_REMOVAL_BATCH_MIN_ACCEPTED), max_batch_size);
+                }
+                // No more streamlines can be removed than are remaining
+                const size_t max_count = std::min (batch_size, size_t(tracks_remaining - term_number));
+                get_removal_candidates (sorter, max_count, current_roc_cf, fixels_in_batch, batch);
+                batch_position = 0;
+                // Every candidate has a negative gradient, and all have been drawn: equivalent to reaching a positive gradient
+                if (batch.empty()) {
+                  recalculate = POS_GRADIENT;
+                  if (!removed_this_iteration)
+                    another_iteration = false;
+                  goto end_iteration;
+                }
+              }
+              const RemovalCandidate& candidate (batch[batch_position++]);
 
-              const track_t candidate_index = candidate->get_tck_index();
+              const track_t candidate_index = candidate.index;
 
-              if (candidate->get_cost_gradient() >= 0.0) {
+              if (candidate.cost_gradient >= 0.0) {
                 recalculate = POS_GRADIENT;
                 if (!removed_this_iteration)
                   another_iteration = false;
@@ -190,31 +234,22 @@ namespace MR
               assert (candidate_index != num_tracks());
               assert (contributions[candidate_index]);
 
-              const double streamline_density_ratio = candidate->get_cost_gradient() / (sum_contributing_length - contributing_length_removed);
+              const double streamline_density_ratio = candidate.cost_gradient / (sum_contributing_length - contributing_length_removed);
               const double required_cf_change_ratio = - term_ratio * streamline_density_ratio * current_cf;
 
-              const TrackContribution& candidate_contribution (*contributions[candidate_index]);
-
-              const double old_mu = mu();
-              const double new_mu = FOD_sum / (TD_sum - candidate_contribution.get_total_contribution());
-              const double mu_change = new_mu - old_mu;
-
-              // Initial estimate of cost change knowing only the change to the normalisation coefficient
-              double this_actual_cf_change = current_roc_cf * mu_change;
-              double quantisation = 0.0;
+              const TrackContribution& candidate_contribution (contributions[candidate_index]);
 
-              for (size_t f = 0; f != candidate_contribution.dim(); ++f) {
-                const Track_fixel_contribution& fixel_cont = candidate_contribution[f];
-                const float length = fixel_cont.get_length();
-                Fixel& this_fixel = fixels[fixel_cont.get_fixel_index()];
-                quantisation += this_fixel.calc_quantisation (old_mu, length);
-                const double undo_change_mu_only = this_fixel.get_d_cost_d_mu (old_mu) * mu_change;
-                const double change_remove_tck = this_fixel.get_cost_wo_track (new_mu, length) - this_fixel.get_cost (old_mu);
-                this_actual_cf_change = this_actual_cf_change - undo_change_mu_only + change_remove_tck;
+              double this_actual_cf_change, quantisation;
+              if (candidate.independent) {
+                assert (candidate.TD_sum == TD_sum);
+                this_actual_cf_change = candidate.cf_change;
+                quantisation = candidate.quantisation;
+              } else {
+                calc_removal_cost (candidate_index, TD_sum, current_roc_cf, this_actual_cf_change, quantisation);
               }
 
               const double required_cf_change_quantisation = enforce_quantisation ? (-0.5 * quantisation) : 0.0;
-              const double this_nonlinearity = (candidate->get_cost_gradient() - this_actual_cf_change);
+              const double this_nonlinearity = (candidate.cost_gradient - this_actual_cf_change);
 
               if (this_actual_cf_change < std::min ( {required_cf_change_ratio, required_cf_change_quantisation, this_nonlinearity })) {
 
@@ -225,9 +260,9 @@ namespace MR
                 }
                 TD_sum -= candidate_contribution.get_total_contribution();
                 contributing_length_removed += candidate_contribution.get_total_length();
-                delete contributions[candidate_index];
-                contributions[candidate_index] = nullptr;
+                contributions[candidate_index].erase();
                 ++removed_this_iteration;
+                ++accepted_this_iteration;
                 --tracks_remaining;
 
               } else {
@@ -265,6 +300,10 @@ namespace MR
 
           end_iteration:
 
+          initial_batch_size = accepted_this_iteration < SIFT_REMOVAL_BATCH_MIN_ACCEPTED ?
+                               1 :
+                               std::min (accepted_this_iteration, max_batch_size);
+
           cf_end_iteration = calc_cost_function();
 
           progress.update (display_func);
@@ -393,7 +432,7 @@ namespace MR
           // Simulate sorting and filtering
           try {
             MT_gradient_vector_sorter sorter (temp_gv, block_size);
-            for (size_t candidate_count = 0; candidate_count < num_tracks / 1000; ++candidate_count)
+            for (size_t candidate_count = 0; candidate_count < num_tracks / 1000 && !sorter.empty(); ++candidate_count)
               sorter.get();
             std::cerr << "Time required for sorting " << num_tracks << " tracks, block size " << block_size << " = " << timer.elapsed() * 1000.0 << "ms\n";
           } catch (...) {
@@ -427,7 +466,7 @@ namespace MR
       {
         if (!contributions[index])
           return std::numeric_limits<double>::max();
-        const TrackContribution& tck_cont = *contributions[index];
+        const TrackContribution& tck_cont = contributions[index];
         const double TD_sum_if_removed = TD_sum - tck_cont.get_total_contribution();
         const double mu_if_removed = FOD_sum / TD_sum_if_removed;
         const double mu_change_if_removed = mu_if_removed - current_mu;
@@ -446,12 +485,91 @@ namespace MR
 
 
 
+      void SIFTer::calc_removal_cost (const track_t index, const double TD_sum_before, const double current_roc_cost, double& cf_change, double& quantisation) const
+      {
+        const TrackContribution& tck_cont = contributions[index];
+        const double old_mu = FOD_sum / TD_sum_before;
+        const double new_mu = FOD_sum / (TD_sum_before - tck_cont.get_total_contribution());
+        const double mu_change = new_mu - old_mu;
+
+        // Initial estimate of cost change knowing only the change to the normalisation coefficient
+        cf_change = current_roc_cost * mu_change;
+        quantisation = 0.0;
+
+        for (size_t f = 0; f != tck_cont.dim(); ++f) {
+          const Track_fixel_contribution& fixel_cont = tck_cont[f];
+          const float length = fixel_cont.get_length();
+          const Fixel& this_fixel = fixels[fixel_cont.get_fixel_index()];
+          quantisation += this_fixel.calc_quantisation (old_mu, length);
+          const double undo_change_mu_only = this_fixel.get_d_cost_d_mu (old_mu) * mu_change;
+          const double change_remove_tck = this_fixel.get_cost_wo_track (new_mu, length) - this_fixel.get_cost (old_mu);
+          cf_change = cf_change - undo_change_mu_only + change_remove_tck;
+        }
+      }
+
+
+
+      void SIFTer::get_removal_candidates (MT_gradient_vector_sorter& sorter, const size_t max_count, const double current_roc_cost, BitSet& fixels_in_batch, vector<RemovalCandidate>& batch) const
+      {
+        batch.clear();
+        // Since any candidate that fails the removal criteria terminates the current iteration,
+        //   a candidate will only ever be considered once all candidates preceding it in the
+        //   batch have been removed; TD_sum at that point is therefore known in advance
+        double TD_sum_before = TD_sum;
+        size_t num_independent = 0;
+        // Stop drawing once the sorter is exhausted
+        while (batch.size() < max_count && !sorter.empty()) {
+          const vector<Cost_fn_gradient_sort>::iterator candidate = sorter.get();
+          batch.push_back (RemovalCandidate (candidate->get_tck_index(), candidate->get_cost_gradient(), TD_sum_before));
+          if (candidate->get_cost_gradient() >= 0.0)
+            break;
+          if (max_count > 1) {
+            // Fixels may only be modified by the removal of candidates preceding this one in
+            //   the batch if they are traversed by this candidate also
+            const TrackContribution& tck_cont = contributions[batch.back().index];
+            bool independent = true;
+            for (size_t f = 0; f != tck_cont.dim(); ++f) {
+              if (fixels_in_batch[tck_cont[f].get_fixel_index()])
+                independent = false;
+              else
+                fixels_in_batch[tck_cont[f].get_fixel_index()] = true;
+            }
+            batch.back().independent = independent;
+            if (independent)
+              ++num_independent;
+            TD_sum_before -= tck_cont.get_total_contribution();
+          }
+        }
+
+        if (max_count == 1)
+          return;
+
+        for (const auto& i : batch) {
+          if (i.cost_gradient < 0.0) {
+            const TrackContribution& tck_cont = contributions[i.index];
+            for (size_t f = 0; f != tck_cont.dim(); ++f)
+              fixels_in_batch[tck_cont[f].get_fixel_index()] = false;
+          }
+        }
+
+        if (num_independent) {
+          TrackIndexRangeWriter writer (SIFT_REMOVAL_BATCH_CHUNK_SIZE, batch.size());
+          RemovalCostCalculator calculator (*this, batch, current_roc_cost);
+          Thread::run_queue (writer, TrackIndexRange(), Thread::multi (calculator));
+        }
+      }
+
+
+
+
+
+
       bool SIFTer::TrackGradientCalculator::operator() (const TrackIndexRange& in) const
       {
         for (track_t track_index = in.first; track_index != in.second; ++track_index) {
           if (master.contributions[track_index]) {
             const double gradient = master.calc_gradient (track_index, current_mu, current_roc_cost);
-            const double grad_per_unit_length = master.contributions[track_index]->get_total_contribution() ? (gradient / master.contributions[track_index]->get_total_contribution()) : 0.0;
+            const double grad_per_unit_length = master.contributions[track_index].get_total_contribution() ? (gradient / master.contributions[track_index].get_total_contribution()) : 0.0;
             gradient_vector[track_index].set (track_index, gradient, grad_per_unit_length);
           } else {
             gradient_vector[track_index].set (master.num_tracks(), 0.0, 0.0);
@@ -463,11 +581,21 @@ namespace MR
 
 
 
+      bool SIFTer::RemovalCostCalculator::operator() (const TrackIndexRange& in) const
+      {
+        for (track_t i = in.first; i != in.second; ++i) {
+          RemovalCandidate& candidate (candidates[i]);
+          if (candidate.independent)
+            master.calc_removal_cost (candidate.index, candidate.TD_sum, current_roc_cost, candidate.cf_change, candidate.quantisation);
+        }
+        return true;
+      }
+
+
+
+
 
       }
     }
   }
 }
-
-
-
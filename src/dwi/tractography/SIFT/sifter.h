@@ -18,6 +18,7 @@
 
 
 
+#include "bitset.h"
 #include "image.h"
 #include "types.h"
 
@@ -108,6 +109,27 @@ namespace MR
         // Convenience functions
         double calc_roc_cost_function() const;
         double calc_gradient (const track_t, const double, const double) const;
+        void   calc_removal_cost (const track_t, const double, const double, double&, double&) const;
+
+
+
+        // A streamline selected for potential removal from the reconstruction
+        // If the streamline shares no fixels with any candidate preceding it within
+        //   the same batch, the change in the cost function due to its removal
+        //   is calculated in advance, based on the value of TD_sum that will be
+        //   present if all preceding candidates are removed
+        class RemovalCandidate
+        { NOMEMALIGN
+          public:
+            RemovalCandidate (const track_t i, const double g, const double TD) :
+                index (i), cost_gradient (g), TD_sum (TD), independent (false), cf_change (0.0), quantisation (0.0) { }
+            track_t index;
+            double cost_gradient, TD_sum;
+            bool independent;
+            double cf_change, quantisation;
+        };
+
+        void get_removal_candidates (MT_gradient_vector_sorter&, const size_t, const double, BitSet&, vector<RemovalCandidate>&) const;
 
 
 
@@ -124,6 +146,19 @@ namespace MR
             const double current_mu, current_roc_cost;
         };
 
+        // For calculating the change in cost function for a batch of removal candidates in a multi-threaded fashion
+        class RemovalCostCalculator
+        { MEMALIGN(RemovalCostCalculator)
+          public:
+            RemovalCostCalculator (const SIFTer& sifter, vector<RemovalCandidate>& c, const double r) :
+                master (sifter), candidates (c), current_roc_cost (r) { }
+            bool operator() (const TrackIndexRange&) const;
+          private:
+            const SIFTer& master;
+            vector<RemovalCandidate>& candidates;
+            const double current_roc_cost;
+        };
+
 
       };
 
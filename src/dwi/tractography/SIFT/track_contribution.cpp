@@ -30,6 +30,32 @@ namespace MR
         float Track_fixel_contribution::min_length_for_storage = 0.0;
 
 
+
+
+        TrackContribution TrackContributionArena::store (const vector<Track_fixel_contribution>& in, const float total_contribution, const float total_length)
+        {
+          std::lock_guard<std::mutex> lock (mutex);
+          Track_fixel_contribution* data;
+          if (in.size() > block_size) {
+            // Streamlines with an unusually large number of contributions get a block of their own
+            blocks.push_back (std::unique_ptr<Track_fixel_contribution[]> (new Track_fixel_contribution [in.size()]));
+            data = blocks.back().get();
+          } else {
+            if (!current || in.size() > remaining) {
+              blocks.push_back (std::unique_ptr<Track_fixel_contribution[]> (new Track_fixel_contribution [block_size]));
+              current = blocks.back().get();
+              remaining = block_size;
+            }
+            data = current;
+            current += in.size();
+            remaining -= in.size();
+          }
+          std::copy (in.begin(), in.end(), data);
+          total += in.size();
+          return TrackContribution (data, in.size(), total_contribution, total_length);
+        }
+
+
       }
     }
   }
@@ -18,9 +18,11 @@
 
 
 #include <cstdint>
+#include <mutex>
 
 #include "header.h"
-#include "min_mem_array.h"
+#include "memory.h"
+#include "types.h"
 
 #include "math/math.h"
 
@@ -36,6 +38,9 @@ namespace MR
 
 
 
+#define SIFT_CONTRIBUTION_ARENA_BLOCK_SIZE (1 << 22)
+
+
 
       class Track_fixel_contribution
       { MEMALIGN(Track_fixel_contribution)
@@ -127,27 +132,83 @@ class Track_fixel_contribution
 
 
 
-      class TrackContribution : public Min_mem_array<Track_fixel_contribution>
-      { MEMALIGN(TrackContribution)
+      // Lightweight handle to the fixel contributions of a single streamline
+      // The contributions themselves are stored contiguously within a
+      //   TrackContributionArena, rather than in a separate heap allocation
+      //   for each streamline; this avoids both the per-allocation overhead
+      //   and heap fragmentation when many millions of streamlines are mapped.
+      // A default-constructed handle is invalid (evaluates to false); this is
+      //   used to indicate streamlines that are not / no longer present.
+      class TrackContribution
+      { NOMEMALIGN
 
         public:
-        TrackContribution (const vector<Track_fixel_contribution>& in, const float c, const float l) :
-            Min_mem_array<Track_fixel_contribution> (in),
+        TrackContribution (Track_fixel_contribution* data, const size_t size, const float c, const float l) :
+            d (data),
+            n (size),
             total_contribution (c),
-            total_length       (l) { }
+            total_length       (l) { assert (d); }
 
         TrackContribution () :
-            Min_mem_array<Track_fixel_contribution> (),
+            d (nullptr),
+            n (0),
             total_contribution (0.0),
             total_length       (0.0) { }
 
-        ~TrackContribution() { }
+        explicit operator bool() const { return d; }
+
+        size_t dim() const { return n; }
+
+        Track_fixel_contribution& operator[] (const size_t i) { assert (i < n); return d[i]; }
+        const Track_fixel_contribution& operator[] (const size_t i) const { assert (i < n); return d[i]; }
 
         float get_total_contribution() const { return total_contribution; }
         float get_total_length      () const { return total_length; }
 
+        // Retain only the first \a size contributions, e.g. after fixels have been removed
+        void truncate (const size_t size, const float contribution) { assert (size <= n); n = size; total_contribution = contribution; }
+
+        // Note that the underlying storage is owned by the arena, and is not released
+        void erase() { d = nullptr; n = 0; }
+
+        private:
+          Track_fixel_contribution* d;
+          uint32_t n;
+          float total_contribution, total_length;
+
+      };
+
+
+
+
+      // Storage for the fixel contributions of all streamlines
+      // Memory is requested from the system in large blocks, from which the
+      //   contributions of individual streamlines are allocated contiguously;
+      //   all memory is released only when the arena itself is destroyed.
+      // Allocation is thread-safe.
+      class TrackContributionArena
+      { NOMEMALIGN
+
+        public:
+          TrackContributionArena (const size_t block_size = SIFT_CONTRIBUTION_ARENA_BLOCK_SIZE) :
+              block_size (block_size),
+              current (nullptr),
+              remaining (0),
+              total (0) { }
+          TrackContributionArena (const TrackContributionArena&) = delete;
+
+          // Copy the contributions of a streamline into the arena
+          TrackContribution store (const vector<Track_fixel_contribution>&, const float total_contribution, const float total_length);
+
+          // Total number of fixel contributions stored
+          size_t size() const { return total; }
+
         private:
-          const float total_contribution, total_length;
+          const size_t block_size;
+          vector<std::unique_ptr<Track_fixel_contribution[]>> blocks;
+          Track_fixel_contribution* current;
+          size_t remaining, total;
+          std::mutex mutex;
 
       };
 
@@ -136,7 +136,7 @@ namespace MR {
           // Update the stats
           local_stats_steps += dFs;
           local_stats_coefficients += new_coefficient;
-          if (master.contributions[track_index] && master.contributions[track_index]->dim() && new_coefficient > master.min_coeff)
+          if (master.contributions[track_index] && master.contributions[track_index].dim() && new_coefficient > master.min_coeff)
             ++local_nonzero_count;
 
 #ifdef STREAMLINE_OF_INTEREST
@@ -171,7 +171,7 @@ namespace MR {
 
       double CoefficientOptimiserBase::do_fixel_exclusion (const SIFT::track_t track_index)
       {
-        const SIFT::TrackContribution& this_contribution (*(master.contributions[track_index]));
+        const SIFT::TrackContribution& this_contribution (master.contributions[track_index]);
 
         // Task 1: Identify the fixel that should be excluded
         size_t index_to_exclude = 0.0;
@@ -13,8 +13,6 @@
  */
 
 
-#include <mutex>
-
 #include "dwi/tractography/SIFT2/fixel_updater.h"
 #include "dwi/tractography/SIFT2/tckfactor.h"
 
@@ -32,20 +30,13 @@ namespace MR {
 
       FixelUpdater::FixelUpdater (TckFactor& tckfactor) :
           master (tckfactor),
-          fixel_coeff_sums (tckfactor.fixels.size(), 0.0),
-          fixel_TDs        (tckfactor.fixels.size(), 0.0),
-          fixel_counts     (tckfactor.fixels.size(), 0) { }
+          buffer (tckfactor.get_fixel_update_buffer()) { }
 
 
 
-      FixelUpdater::~FixelUpdater()
-      {
-        std::lock_guard<std::mutex> lock (master.mutex);
-        for (size_t i = 0; i != master.fixels.size(); ++i) {
-          master.fixels[i].add_to_mean_coeff (fixel_coeff_sums[i]);
-          master.fixels[i].add_TD (fixel_TDs[i], fixel_counts[i]);
-        }
-      }
+      FixelUpdater::FixelUpdater (const FixelUpdater& that) :
+          master (that.master),
+          buffer (that.master.get_fixel_update_buffer()) { }
 
 
 
@@ -53,15 +44,42 @@ namespace MR {
       {
         for (SIFT::track_t track_index = range.first; track_index != range.second; ++track_index) {
           const double coefficient = master.coefficients[track_index];
-          const SIFT::TrackContribution& this_contribution (*(master.contributions[track_index]));
+          const SIFT::TrackContribution& this_contribution (master.contributions[track_index]);
           const double weighting_factor = (coefficient > master.min_coeff) ? std::exp (coefficient) : 0.0;
           for (size_t j = 0; j != this_contribution.dim(); ++j) {
             const size_t fixel_index = this_contribution[j].get_fixel_index();
             const float length = this_contribution[j].get_length();
-            fixel_coeff_sums[fixel_index] += length * coefficient;
-            fixel_TDs       [fixel_index] += length * weighting_factor;
-            fixel_counts    [fixel_index]++;
+            buffer.coeff_sums[fixel_index] += length * coefficient;
+            buffer.TDs       [fixel_index] += length * weighting_factor;
+            buffer.counts    [fixel_index]++;
+          }
+        }
+        return true;
+      }
+
+
+
+
+      bool FixelUpdateReducer::operator() (const SIFT::TrackIndexRange& range)
+      {
+        const size_t num_buffers = master.fixel_update_buffers_in_use;
+        for (size_t fixel_index = range.first; fixel_index != range.second; ++fixel_index) {
+          double coeff_sum = 0.0, TD = 0.0;
+          SIFT::track_t count = 0;
+          for (size_t i = 0; i != num_buffers; ++i) {
+            FixelUpdateBuffer& buffer (*master.fixel_update_buffers[i]);
+            coeff_sum += buffer.coeff_sums[fixel_index];
+            TD        += buffer.TDs       [fixel_index];
+            count     += buffer.counts    [fixel_index];
+            buffer.coeff_sums[fixel_index] = 0.0;
+            buffer.TDs       [fixel_index] = 0.0;
+            buffer.counts    [fixel_index] = 0;
           }
+          Fixel& fixel (master.fixels[fixel_index]);
+          fixel.clear_TD();
+          fixel.clear_mean_coeff();
+          fixel.add_to_mean_coeff (coeff_sum);
+          fixel.add_TD (TD, count);
         }
         return true;
       }
@@ -32,22 +32,58 @@ namespace MR {
       class TckFactor;
 
 
+
+      // Per-thread accumulators for the streamline densities and mean
+      //   coefficients within fixels; these are retained by TckFactor between
+      //   iterations, rather than being re-allocated every time
+      class FixelUpdateBuffer
+      { NOMEMALIGN
+        public:
+          FixelUpdateBuffer (const size_t num_fixels) :
+              coeff_sums (num_fixels, 0.0),
+              TDs        (num_fixels, 0.0),
+              counts     (num_fixels, 0) { }
+
+          vector<double> coeff_sums;
+          vector<double> TDs;
+          vector<SIFT::track_t> counts;
+      };
+
+
+
       class FixelUpdater
       { MEMALIGN(FixelUpdater)
 
         public:
           FixelUpdater (TckFactor&);
-          ~FixelUpdater();
+          FixelUpdater (const FixelUpdater&);
 
           bool operator() (const SIFT::TrackIndexRange& range);
 
         private:
           TckFactor& master;
 
-          // Each thread needs a local copy of these
-          vector<double> fixel_coeff_sums;
-          vector<double> fixel_TDs;
-          vector<SIFT::track_t> fixel_counts;
+          // Each thread needs its own buffer
+          FixelUpdateBuffer& buffer;
+
+      };
+
+
+
+      // Sums the contents of all buffers used by FixelUpdater into the fixels,
+      //   resetting the buffers for the next iteration; this is multi-threaded
+      //   over fixels, rather than each thread adding its own buffer to all
+      //   fixels in turn while holding a lock
+      class FixelUpdateReducer
+      { MEMALIGN(FixelUpdateReducer)
+
+        public:
+          FixelUpdateReducer (TckFactor& tckfactor) : master (tckfactor) { }
+
+          bool operator() (const SIFT::TrackIndexRange& range);
+
+        private:
+          TckFactor& master;
 
       };
 
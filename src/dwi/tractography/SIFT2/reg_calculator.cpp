@@ -53,7 +53,7 @@ namespace MR {
         for (SIFT::track_t track_index = range.first; track_index != range.second; ++track_index) {
           const double coefficient = master.coefficients[track_index];
           tikhonov_sum += Math::pow2 (coefficient);
-          const SIFT::TrackContribution& this_contribution (*(master.contributions[track_index]));
+          const SIFT::TrackContribution& this_contribution (master.contributions[track_index]);
           const double contribution_multiplier = 1.0 / this_contribution.get_total_contribution();
           double this_tv_sum = 0.0;
           for (size_t j = 0; j != this_contribution.dim(); ++j) {
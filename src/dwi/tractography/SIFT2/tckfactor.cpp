@@ -114,7 +114,7 @@ namespace MR {
         TD_sum = 0.0;
 
         for (SIFT::track_t track_index = 0; track_index != num_tracks(); ++track_index) {
-          const SIFT::TrackContribution& tck_cont (*contributions[track_index]);
+          const SIFT::TrackContribution& tck_cont (contributions[track_index]);
           const double weight = 1.0 / tck_cont.get_total_length();
           coefficients[track_index] = std::log (weight);
           for (size_t i = 0; i != tck_cont.dim(); ++i)
@@ -151,7 +151,7 @@ namespace MR {
 
         // Just do single-threaded for now
         for (SIFT::track_t i = 0; i != num_tracks(); ++i) {
-          const SIFT::TrackContribution& tckcont = *contributions[i];
+          const SIFT::TrackContribution& tckcont = contributions[i];
           double sum_afd = 0.0;
           for (size_t f = 0; f != tckcont.dim(); ++f) {
             const size_t fixel_index = tckcont[f].get_fixel_index();
@@ -163,15 +163,7 @@ namespace MR {
           coefficients[i] = std::log (afcsa / fixed_mu);
         }
 
-        for (vector<Fixel>::iterator i = fixels.begin(); i != fixels.end(); ++i) {
-          i->clear_TD();
-          i->clear_mean_coeff();
-        }
-        {
-          SIFT::TrackIndexRangeWriter writer (SIFT_TRACK_INDEX_BUFFER_SIZE, num_tracks());
-          FixelUpdater worker (*this);
-          Thread::run_queue (writer, SIFT::TrackIndexRange(), Thread::multi (worker));
-        }
+        update_fixels();
 
         VAR (calc_cost_function());
 
@@ -198,7 +190,7 @@ namespace MR {
 
         unsigned int nonzero_streamlines = 0;
         for (SIFT::track_t i = 0; i != num_tracks(); ++i) {
-          if (contributions[i] && contributions[i]->dim())
+          if (contributions[i] && contributions[i].dim())
             ++nonzero_streamlines;
         }
 
@@ -266,15 +258,7 @@ namespace MR {
           }
 
           // Multi-threaded calculation of updated streamline density, and mean weighting coefficient, in each fixel
-          for (vector<Fixel>::iterator i = fixels.begin(); i != fixels.end(); ++i) {
-            i->clear_TD();
-            i->clear_mean_coeff();
-          }
-          {
-            SIFT::TrackIndexRangeWriter writer (SIFT_TRACK_INDEX_BUFFER_SIZE, num_tracks());
-            FixelUpdater worker (*this);
-            Thread::run_queue (writer, SIFT::TrackIndexRange(), Thread::multi (worker));
-          }
+          update_fixels();
           // Scale the fixel mean coefficient terms (each streamline in the fixel is weighted by its length)
           for (vector<Fixel>::iterator i = fixels.begin(); i != fixels.end(); ++i)
             i->normalise_mean_coeff();
@@ -358,7 +342,7 @@ namespace MR {
           ProgressBar progress ("Generating streamline coefficient statistic images", num_tracks());
           for (SIFT::track_t i = 0; i != num_tracks(); ++i) {
             const double coeff = coefficients[i];
-            const SIFT::TrackContribution& this_contribution (*contributions[i]);
+            const SIFT::TrackContribution& this_contribution (contributions[i]);
             if (coeff > min_coeff) {
               for (size_t j = 0; j != this_contribution.dim(); ++j) {
                 const size_t fixel_index = this_contribution[j].get_fixel_index();
@@ -438,6 +422,37 @@ namespace MR {
 
 
 
+      FixelUpdateBuffer& TckFactor::get_fixel_update_buffer()
+      {
+        std::lock_guard<std::mutex> lock (mutex);
+        if (fixel_update_buffers_in_use == fixel_update_buffers.size())
+          fixel_update_buffers.push_back (std::unique_ptr<FixelUpdateBuffer> (new FixelUpdateBuffer (fixels.size())));
+        // The number of fixels may have changed since the buffer was last used
+        else if (fixel_update_buffers[fixel_update_buffers_in_use]->TDs.size() != fixels.size())
+          fixel_update_buffers[fixel_update_buffers_in_use].reset (new FixelUpdateBuffer (fixels.size()));
+        return *fixel_update_buffers[fixel_update_buffers_in_use++];
+      }
+
+
+
+      void TckFactor::update_fixels()
+      {
+        {
+          SIFT::TrackIndexRangeWriter writer (SIFT_TRACK_INDEX_BUFFER_SIZE, num_tracks());
+          FixelUpdater worker (*this);
+          Thread::run_queue (writer, SIFT::TrackIndexRange(), Thread::multi (worker));
+        }
+        {
+          SIFT::TrackIndexRangeWriter writer (SIFT_TRACK_INDEX_BUFFER_SIZE, fixels.size());
+          FixelUpdateReducer worker (*this);
+          Thread::run_queue (writer, SIFT::TrackIndexRange(), Thread::multi (worker));
+        }
+        fixel_update_buffers_in_use = 0;
+      }
+
+
+
+
       }
     }
   }
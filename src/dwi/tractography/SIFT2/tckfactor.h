@@ -30,6 +30,7 @@
 #include "dwi/tractography/SIFT/output.h"
 
 #include "dwi/tractography/SIFT2/fixel.h"
+#include "dwi/tractography/SIFT2/fixel_updater.h"
 
 
 
@@ -70,7 +71,8 @@ namespace MR {
               max_coeff (SIFT2_MAX_COEFF_DEFAULT),
               max_coeff_step (SIFT2_MAX_COEFF_STEP_DEFAULT),
               min_cf_decrease_percentage (SIFT2_MIN_CF_DECREASE_DEFAULT),
-              data_scale_term (0.0) { }
+              data_scale_term (0.0),
+              fixel_update_buffers_in_use (0) { }
 
 
           void set_reg_lambdas     (const double, const double);
@@ -124,12 +126,21 @@ namespace MR {
           friend class CoefficientOptimiserQLS;
           friend class CoefficientOptimiserIterative;
           friend class FixelUpdater;
+          friend class FixelUpdateReducer;
           friend class RegularisationCalculator;
 
 
           // For when multiple threads are trying to write their final information back
           std::mutex mutex;
 
+          // Thread-local buffers for updating the fixels, retained between iterations
+          vector<std::unique_ptr<FixelUpdateBuffer>> fixel_update_buffers;
+          size_t fixel_update_buffers_in_use;
+          FixelUpdateBuffer& get_fixel_update_buffer();
+
+          // Re-calculate the streamline density & mean coefficient in each fixel
+          void update_fixels();
+
           void indicate_progress() { if (App::log_level) fprintf (stderr, "."); }
 
       };
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2008-2018 the MRtrix3 contributors.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at http://mozilla.org/MPL/2.0/
+ *
+ * MRtrix3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * For more details, see http://www.mrtrix.org/
+ */
+
+
+#include "dwi/tractography/connectome/assignments.h"
+
+#include <fstream>
+
+#include "algo/loop.h"
+#include "datatype.h"
+#include "image_helpers.h"
+#include "raw.h"
+#include "file/key_value.h"
+#include "file/ofstream.h"
+#include "file/path.h"
+
+
+namespace MR {
+namespace DWI {
+namespace Tractography {
+namespace Connectome {
+
+
+
+namespace {
+
+  const char* first_line = "mrtrix streamline assignments";
+
+  std::string transform_to_string (const transform_type& T) {
+    std::string s;
+    for (ssize_t i = 0; i < 3; ++i)
+      for (ssize_t j = 0; j < 4; ++j)
+        s += (s.size() ? "," : "") + str (T(i,j), 10);
+    return s;
+  }
+
+  void write (const std::string& path, const AssignmentsCache::Info& info, const bool pair, const size_t count, const vector<uint32_t>& data)
+  {
+    File::OFStream out (path, std::ios::out | std::ios::binary);
+    out << first_line << "\n";
+    out << "assignment: " << info.assignment << "\n";
+    if (info.timestamp.size())
+      out << "timestamp: " << info.timestamp << "\n";
+    out << "max_node_index: " << info.max_node_index << "\n";
+    const Header& H (info.parcellation);
+    out << "parcellation_dim: " << H.size(0) << "," << H.size(1) << "," << H.size(2) << "\n";
+    out << "parcellation_vox: " << str (H.spacing(0), 10) << "," << str (H.spacing(1), 10) << "," << str (H.spacing(2), 10) << "\n";
+    out << "parcellation_transform: " << transform_to_string (H.transform()) << "\n";
+    out << "parcellation_hash: " << info.parcellation_hash << "\n";
+    out << "nodes_per_streamline: " << (pair ? "2" : "variable") << "\n";
+    out << "count: " << count << "\n";
+    out << "datatype: " << DataType (DataType::UInt32LE).specifier() << "\n";
+    int64_t data_offset = int64_t(out.tellp()) + 32;
+    data_offset += (4 - (data_offset % 4)) % 4;
+    out << "file: . " << data_offset << "\nEND\n";
+    out.seekp (data_offset);
+    out.write (reinterpret_cast<const char*> (data.data()), data.size() * sizeof (uint32_t));
+    if (!out.good())
+      throw Exception ("error writing streamline assignments file \"" + path + "\": " + strerror (errno));
+  }
+
+}
+
+
+
+void AssignmentsCache::Info::set_parcellation (Image<node_t> nodes)
+{
+  parcellation = Header (nodes);
+  // 64-bit FNV-1a hash of the node labels, in voxel order irrespective of strides
+  parcellation_hash = 14695981039346656037ULL;
+  max_node_index = 0;
+  for (auto l = Loop (nodes) (nodes); l; ++l) {
+    const node_t value = nodes.value();
+    max_node_index = std::max (max_node_index, value);
+    for (size_t b = 0; b != sizeof (node_t); ++b) {
+      parcellation_hash ^= (value >> (8*b)) & 0xFF;
+      parcellation_hash *= 1099511628211ULL;
+    }
+  }
+}
+
+
+
+bool AssignmentsCache::Info::same_parcellation (const Info& that) const
+{
+  return max_node_index == that.max_node_index &&
+         parcellation_hash == that.parcellation_hash &&
+         voxel_grids_match_in_scanner_space (parcellation, that.parcellation);
+}
+
+
+
+AssignmentsCache::AssignmentsCache (const std::string& path) :
+    path (path),
+    pair (true),
+    count (0)
+{
+  File::KeyValue kv (path, first_line);
+  std::string data_file, nodes_per_streamline;
+  DataType dtype;
+  bool count_found = false, parcellation_found = false, hash_found = false;
+  auto parse_values = [&] (const size_t num) {
+    const auto values = parse_floats (kv.value());
+    if (values.size() != num)
+      throw Exception ("malformed \"" + kv.key() + "\" entry in streamline assignments file \"" + path + "\"");
+    return values;
+  };
+  properties.parcellation.ndim() = 3;
+  while (kv.next()) {
+    const std::string key = lowercase (kv.key());
+    if (key == "assignment") properties.assignment = kv.value();
+    else if (key == "timestamp") properties.timestamp = kv.value();
+    else if (key == "max_node_index") properties.max_node_index = to<node_t> (kv.value());
+    else if (key == "parcellation_dim") {
+      const auto dim = parse_values (3);
+      for (size_t i = 0; i != 3; ++i)
+        properties.parcellation.size(i) = dim[i];
+      parcellation_found = true;
+    }
+    else if (key == "parcellation_vox") {
+      const auto vox = parse_values (3);
+      for (size_t i = 0; i != 3; ++i)
+        properties.parcellation.spacing(i) = vox[i];
+    }
+    else if (key == "parcellation_transform") {
+      const auto T = parse_values (12);
+      for (ssize_t i = 0; i != 3; ++i)
+        for (ssize_t j = 0; j != 4; ++j)
+          properties.parcellation.transform()(i,j) = T[4*i+j];
+    }
+    else if (key == "parcellation_hash") { properties.parcellation_hash = to<uint64_t> (kv.value()); hash_found = true; }
+    else if (key == "nodes_per_streamline") nodes_per_streamline = kv.value();
+    else if (key == "count") { count = to<size_t> (kv.value()); count_found = true; }
+    else if (key == "datatype") dtype = DataType::parse (kv.value());
+    else if (key == "file") data_file = kv.value();
+  }
+
+  if (!count_found)
+    throw Exception ("missing \"count\" specification in streamline assignments file \"" + path + "\"");
+  if (!parcellation_found || !hash_found)
+    throw Exception ("missing parcellation image properties in streamline assignments file \"" + path + "\"");
+  properties.parcellation.name() = path;
+  if (nodes_per_streamline == "2")
+    pair = true;
+  else if (nodes_per_streamline == "variable")
+    pair = false;
+  else
+    throw Exception ("invalid or missing \"nodes_per_streamline\" specification in streamline assignments file \"" + path + "\"");
+  if (dtype != DataType::UInt32LE)
+    throw Exception ("only supported datatype for streamline assignments file is UInt32LE (in file \"" + path + "\")");
+
+  std::istringstream files_stream (data_file);
+  std::string fname;
+  int64_t offset = 0;
+  files_stream >> fname >> offset;
+  if (fname.empty() || !files_stream)
+    throw Exception ("invalid \"file\" specification in streamline assignments file \"" + path + "\"");
+  fname = (fname == ".") ? path : Path::join (Path::dirname (path), fname);
+
+  std::ifstream in (fname.c_str(), std::ios::in | std::ios::binary);
+  if (!in)
+    throw Exception ("error opening streamline assignments data file \"" + fname + "\": " + strerror (errno));
+  in.seekg (0, std::ios::end);
+  const int64_t file_size = in.tellg();
+  in.seekg (offset);
+  vector<uint32_t> data (std::max (file_size - offset, int64_t(0)) / sizeof (uint32_t));
+  in.read (reinterpret_cast<char*> (data.data()), data.size() * sizeof (uint32_t));
+  if (!in)
+    throw Exception ("error reading streamline assignments data file \"" + fname + "\"");
+
+  const std::string truncated ("streamline assignments file \"" + path + "\" is truncated");
+  if (pair) {
+    if (data.size() < 2 * count)
+      throw Exception (truncated);
+    pairs.reserve (count);
+    for (size_t i = 0; i != count; ++i)
+      pairs.push_back (NodePair (Raw::fetch_LE<uint32_t> (data.data(), 2*i), Raw::fetch_LE<uint32_t> (data.data(), 2*i+1)));
+  } else {
+    lists.reserve (count);
+    size_t i = 0;
+    for (size_t n = 0; n != count; ++n) {
+      if (i == data.size())
+        throw Exception (truncated);
+      const size_t num_nodes = Raw::fetch_LE<uint32_t> (data.data(), i++);
+      if (i + num_nodes > data.size())
+        throw Exception (truncated);
+      vector<node_t> nodes;
+      nodes.reserve (num_nodes);
+      for (size_t j = 0; j != num_nodes; ++j)
+        nodes.push_back (Raw::fetch_LE<uint32_t> (data.data(), i++));
+      lists.push_back (std::move (nodes));
+    }
+  }
+}
+
+
+
+void AssignmentsCache::save (const std::string& path, const Info& info, const vector<NodePair>& assignments)
+{
+  vector<uint32_t> data (2 * assignments.size());
+  for (size_t i = 0; i != assignments.size(); ++i) {
+    Raw::store_LE<uint32_t> (assignments[i].first,  data.data(), 2*i);
+    Raw::store_LE<uint32_t> (assignments[i].second, data.data(), 2*i+1);
+  }
+  write (path, info, true, assignments.size(), data);
+}
+
+void AssignmentsCache::save (const std::string& path, const Info& info, const vector< vector<node_t> >& assignments)
+{
+  vector<uint32_t> data;
+  for (const auto& nodes : assignments) {
+    data.push_back (ByteOrder::LE (uint32_t (nodes.size())));
+    for (auto n : nodes)
+      data.push_back (ByteOrder::LE (uint32_t (n)));
+  }
+  write (path, info, false, assignments.size(), data);
+}
+
+
+
+
+}
+}
+}
+}
+
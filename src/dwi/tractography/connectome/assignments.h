@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2008-2018 the MRtrix3 contributors.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at http://mozilla.org/MPL/2.0/
+ *
+ * MRtrix3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * For more details, see http://www.mrtrix.org/
+ */
+
+
+#ifndef __dwi_tractography_connectome_assignments_h__
+#define __dwi_tractography_connectome_assignments_h__
+
+#include "header.h"
+#include "image.h"
+#include "types.h"
+
+#include "dwi/tractography/connectome/connectome.h"
+
+
+namespace MR {
+namespace DWI {
+namespace Tractography {
+namespace Connectome {
+
+
+
+
+// Compact binary storage of the nodes to which each streamline in a tractogram
+//   has been assigned, so that further connectomes can be generated from the
+//   same tractogram & parcellation without repeating the assignment of
+//   streamlines to nodes
+//
+// The file consists of a text header, terminated by "END", followed by the
+//   assignments as unsigned 32-bit little-endian integers: either two values
+//   per streamline, or (if streamlines may be assigned to any number of nodes)
+//   the number of nodes followed by the node indices. The header also records
+//   the voxel grid & a hash of the labels of the parcellation image, so that
+//   the assignments are not applied to a different parcellation
+class AssignmentsCache
+{ MEMALIGN(AssignmentsCache)
+
+  public:
+    AssignmentsCache (const std::string& path);
+
+    // Properties of the data from which the assignments were generated
+    class Info
+    { MEMALIGN(Info)
+      public:
+        Info () : max_node_index (0), parcellation_hash (0) { }
+        // Record the voxel grid, maximal node index & a hash of the node
+        //   labels of the parcellation image
+        void set_parcellation (Image<node_t>);
+        // Whether two sets of properties refer to the same parcellation image
+        bool same_parcellation (const Info&) const;
+        // Description of the streamline assignment mechanism
+        std::string assignment;
+        // Timestamp of the tractogram (if present)
+        std::string timestamp;
+        node_t max_node_index;
+        Header parcellation;
+        uint64_t parcellation_hash;
+    };
+
+    static void save (const std::string& path, const Info& info, const vector<NodePair>& assignments);
+    static void save (const std::string& path, const Info& info, const vector< vector<node_t> >& assignments);
+
+    const std::string& name() const { return path; }
+    const Info& info() const { return properties; }
+    bool provides_pair() const { return pair; }
+    size_t size() const { return count; }
+
+    const NodePair& get_pair (const size_t index) const
+    {
+      assert (pair);
+      check (index);
+      return pairs[index];
+    }
+
+    const vector<node_t>& get_list (const size_t index) const
+    {
+      assert (!pair);
+      check (index);
+      return lists[index];
+    }
+
+
+  private:
+    const std::string path;
+    Info properties;
+    bool pair;
+    size_t count;
+    vector<NodePair> pairs;
+    vector< vector<node_t> > lists;
+
+    void check (const size_t index) const
+    {
+      if (index >= count)
+        throw Exception ("Streamline assignments file \"" + path + "\" contains fewer entries (" + str(count) + ") than the tractogram");
+    }
+
+};
+
+
+
+
+}
+}
+}
+}
+
+
+#endif
+
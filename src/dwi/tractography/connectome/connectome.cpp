@@ -94,6 +94,25 @@ Tck2nodes_base* load_assignment_mode (Image<node_t>& nodes_data)
 
 
 
+// Summary of the streamline assignment mechanism selected by load_assignment_mode(),
+//   e.g. for verifying that previously-computed assignments are applicable
+std::string assignment_mode_description()
+{
+  for (size_t index = 0; modes[index]; ++index) {
+    auto opt = get_options (modes[index]);
+    if (opt.size()) {
+      // Strip the "assignment_" prefix
+      std::string result (modes[index] + 11);
+      if (opt[0].opt->size())
+        result += " " + str(float(opt[0][0]));
+      return result;
+    }
+  }
+  return "radial_search " + str(float(TCK2NODES_RADIAL_DEFAULT_DIST));
+}
+
+
+
 
 const OptionGroup MetricOptions = OptionGroup ("Structural connectome metric options")
 
@@ -47,6 +47,7 @@ class Metric;
 extern const char* modes[];
 extern const App::OptionGroup AssignmentOptions;
 Tck2nodes_base* load_assignment_mode (Image<node_t>&);
+std::string assignment_mode_description();
 
 extern const App::OptionGroup MetricOptions;
 void setup_metric (Metric&, Image<node_t>&);
@@ -18,6 +18,7 @@
 
 #include "dwi/tractography/streamline.h"
 #include "dwi/tractography/connectome/mapped_track.h"
+#include "dwi/tractography/connectome/matrix.h"
 #include "dwi/tractography/connectome/metric.h"
 #include "dwi/tractography/connectome/tck2nodes.h"
 
@@ -42,6 +43,7 @@ class Mapper
       tck2nodes (that.tck2nodes),
       metric (that.metric) { }
 
+    bool provides_pair() const { return tck2nodes.provides_pair(); }
 
     bool operator() (const Tractography::Streamline<float>& in, Mapped_track_nodepair& out)
     {
@@ -74,6 +76,82 @@ class Mapper
 
 
 
+// Maps streamlines and adds their contributions directly to per-thread
+//   matrices, so that all threads can fill the connectome concurrently rather
+//   than queueing mapped streamlines for a single thread to apply.
+// Multiple connectomes (e.g. from different parcellations) can be filled from
+//   a single pass through the tractogram, by providing one mapper per matrix.
+//   Each connectome may use either single- or double-precision storage: for
+//   each mapper, exactly one of the corresponding entries in the two vectors
+//   of matrices must be non-null.
+class MatrixWorker
+{ MEMALIGN(MatrixWorker)
+
+  public:
+    MatrixWorker (const vector<Mapper>& mappers,
+                  const vector<Matrix<float>*>& float_matrices,
+                  const vector<Matrix<double>*>& double_matrices) :
+      mappers (mappers),
+      float_masters (float_matrices),
+      double_masters (double_matrices),
+      float_thread_matrices (mappers.size(), nullptr),
+      double_thread_matrices (mappers.size(), nullptr)
+    {
+      assert (mappers.size() == float_matrices.size());
+      assert (mappers.size() == double_matrices.size());
+#ifndef NDEBUG
+      for (size_t i = 0; i != mappers.size(); ++i)
+        assert (bool(float_matrices[i]) != bool(double_matrices[i]));
+#endif
+    }
+
+    MatrixWorker (const MatrixWorker& that) :
+      mappers (that.mappers),
+      float_masters (that.float_masters),
+      double_masters (that.double_masters),
+      float_thread_matrices (that.mappers.size(), nullptr),
+      double_thread_matrices (that.mappers.size(), nullptr) { }
+
+
+    bool operator() (const Tractography::Streamline<float>& in)
+    {
+      for (size_t i = 0; i != mappers.size(); ++i) {
+        if (float_masters[i])
+          map (mappers[i], in, *float_masters[i], float_thread_matrices[i]);
+        else
+          map (mappers[i], in, *double_masters[i], double_thread_matrices[i]);
+      }
+      return true;
+    }
+
+
+  private:
+    vector<Mapper> mappers;
+    const vector<Matrix<float>*> float_masters;
+    const vector<Matrix<double>*> double_masters;
+    vector<Matrix<float>*> float_thread_matrices;
+    vector<Matrix<double>*> double_thread_matrices;
+    Mapped_track_nodepair nodepair;
+    Mapped_track_nodelist nodelist;
+
+    template <typename T>
+    void map (Mapper& mapper, const Tractography::Streamline<float>& in, Matrix<T>& master, Matrix<T>*& matrix)
+    {
+      if (!matrix)
+        matrix = &master.thread_matrix();
+      if (mapper.provides_pair()) {
+        mapper (in, nodepair);
+        (*matrix) (nodepair);
+      } else {
+        mapper (in, nodelist);
+        (*matrix) (nodelist);
+      }
+    }
+
+};
+
+
+
 
 }
 }
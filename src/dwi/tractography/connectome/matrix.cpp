@@ -41,38 +41,23 @@ const App::Option EdgeStatisticOption
 template <typename T>
 bool Matrix<T>::operator() (const Mapped_track_nodepair& in)
 {
+  std::unique_lock<std::mutex> lock (mutex, std::defer_lock);
+  if (is_shared)
+    lock.lock();
   assert (in.get_first_node()  < mat2vec->mat_size());
   assert (in.get_second_node() < mat2vec->mat_size());
   assert (assignments_lists.empty());
   if (is_vector()) {
-    assert (assignments_pairs.empty());
     apply_data (in.get_second_node(), in.get_factor(), in.get_weight());
     inc_count (in.get_second_node(), in.get_weight());
-    if (track_assignments) {
-      if (in.get_track_index() == assignments_single.size()) {
-        assignments_single.push_back (in.get_second_node());
-      } else if (in.get_track_index() < assignments_single.size()) {
-        assignments_single[in.get_track_index()] = in.get_second_node();
-      } else {
-        assignments_single.resize (in.get_track_index() + 1, 0);
-        assignments_single[in.get_track_index()] = in.get_second_node();
-      }
-    }
   } else {
-    assert (assignments_single.empty());
     apply_data (in.get_first_node(), in.get_second_node(), in.get_factor(), in.get_weight());
     inc_count (in.get_first_node(), in.get_second_node(), in.get_weight());
-    if (track_assignments) {
-      if (in.get_track_index() == assignments_pairs.size()) {
-        assignments_pairs.push_back (in.get_nodes());
-      } else if (in.get_track_index() < assignments_pairs.size()) {
-        assignments_pairs[in.get_track_index()] = in.get_nodes();
-      } else {
-        assignments_pairs.resize (in.get_track_index() + 1, std::make_pair<size_t, size_t> (0, 0));
-        assignments_pairs[in.get_track_index()] = in.get_nodes();
-      }
-    }
   }
+  // The complete node pair is stored even for vector output, since it is required
+  //   in order to reproduce the metric from the assignments (-out_assignments_cache)
+  if (track_assignments)
+    store_assignment (assignments_pairs, in.get_track_index(), NodePair (in.get_nodes()), NodePair (0, 0));
   return true;
 }
 
@@ -81,7 +66,9 @@ bool Matrix<T>::operator() (const Mapped_track_nodepair& in)
 template <typename T>
 bool Matrix<T>::operator() (const Mapped_track_nodelist& in)
 {
-  assert (assignments_single.empty());
+  std::unique_lock<std::mutex> lock (mutex, std::defer_lock);
+  if (is_shared)
+    lock.lock();
   assert (assignments_pairs.empty());
   vector<node_t> list (in.get_nodes());
   for (vector<node_t>::const_iterator i = list.begin(); i != list.end(); ++i) {
@@ -91,7 +78,6 @@ bool Matrix<T>::operator() (const Mapped_track_nodelist& in)
     if (list.empty()) {
       apply_data (0, in.get_factor(), in.get_weight());
       inc_count (0, in.get_weight());
-      list.push_back (0);
     } else {
       for (vector<node_t>::const_iterator n = list.begin(); n != list.end(); ++n) {
         apply_data (*n, in.get_factor(), in.get_weight());
@@ -102,7 +88,6 @@ bool Matrix<T>::operator() (const Mapped_track_nodelist& in)
     if (list.empty()) {
       apply_data (0, 0, in.get_factor(), in.get_weight());
       inc_count (0, 0, in.get_weight());
-      list.push_back (0);
     } else if (list.size() == 1) {
       apply_data (0, list.front(), in.get_factor(), in.get_weight());
       inc_count (0, list.front(), in.get_weight());
@@ -117,23 +102,33 @@ bool Matrix<T>::operator() (const Mapped_track_nodelist& in)
   }
   if (track_assignments) {
     std::sort (list.begin(), list.end());
-    if (in.get_track_index() == assignments_lists.size()) {
-      assignments_lists.push_back (std::move (list));
-    } else if (in.get_track_index() < assignments_lists.size()) {
-      assignments_lists[in.get_track_index()] = std::move (list);
-    } else {
-      assignments_lists.resize (in.get_track_index() + 1, vector<node_t>());
-      assignments_lists[in.get_track_index()] = std::move (list);
-    }
+    store_assignment (assignments_lists, in.get_track_index(), std::move (list), vector<node_t>());
   }
   return true;
 }
 
 
 
+template <typename T>
+Matrix<T>& Matrix<T>::thread_matrix()
+{
+  if (is_shared)
+    return *this;
+  std::lock_guard<std::mutex> lock (mutex);
+  const node_t max_node_index = (vector_output ? data.size() : mat2vec->mat_size()) - 1;
+  thread_matrices.push_back (std::unique_ptr<Matrix> (new Matrix (max_node_index, statistic, vector_output, track_assignments, true)));
+  return *thread_matrices.back();
+}
+
+
+
 template <typename T>
 void Matrix<T>::finalize()
 {
+  for (auto& i : thread_matrices)
+    merge (*i);
+  thread_matrices.clear();
+
   switch (statistic) {
     case stat_edge::SUM:
       return;
@@ -196,12 +191,18 @@ void Matrix<T>::write_assignments (const std::string& path) const
   if (!track_assignments)
     throw Exception ("Cannot write streamline assignments to file as they were not stored during processing");
   File::OFStream stream (path);
-  for (auto i = assignments_single.begin(); i != assignments_single.end(); ++i)
-    stream << str(*i) << "\n";
-  for (auto i = assignments_pairs.begin(); i != assignments_pairs.end(); ++i)
-    stream << str(i->first) << " " << str(i->second) << "\n";
+  for (auto i = assignments_pairs.begin(); i != assignments_pairs.end(); ++i) {
+    if (vector_output)
+      stream << str(i->second) << "\n";
+    else
+      stream << str(i->first) << " " << str(i->second) << "\n";
+  }
   for (auto i = assignments_lists.begin(); i != assignments_lists.end(); ++i) {
-    assert (i->size());
+    // A streamline not assigned to any node is written as being assigned to node 0
+    if (i->empty()) {
+      stream << "0\n";
+      continue;
+    }
     stream << str((*i)[0]);
     for (size_t j = 1; j != i->size(); ++j)
       stream << " " << str((*i)[j]);
@@ -211,6 +212,19 @@ void Matrix<T>::write_assignments (const std::string& path) const
 
 
 
+template <typename T>
+void Matrix<T>::write_assignments_cache (const std::string& path, const AssignmentsCache::Info& info) const
+{
+  if (!track_assignments)
+    throw Exception ("Cannot write streamline assignments to file as they were not stored during processing");
+  if (assignments_lists.size())
+    AssignmentsCache::save (path, info, assignments_lists);
+  else
+    AssignmentsCache::save (path, info, assignments_pairs);
+}
+
+
+
 template <typename T>
 void Matrix<T>::save (const std::string& path,
                       const bool keep_unassigned,
@@ -255,6 +269,52 @@ void Matrix<T>::save (const std::string& path,
 
 
 
+template <typename T>
+void Matrix<T>::merge (Matrix<T>& that)
+{
+  assert (that.is_thread_matrix);
+  assert (that.data.size() == data.size());
+  switch (statistic) {
+    case stat_edge::SUM:
+      data += that.data;
+      break;
+    case stat_edge::MEAN:
+      data += that.data;
+      counts += that.counts;
+      break;
+    case stat_edge::MIN:
+      data = data.cwiseMin (that.data);
+      break;
+    case stat_edge::MAX:
+      data = data.cwiseMax (that.data);
+      break;
+  }
+  for (size_t i = 0; i != that.assignments_pairs.size(); ++i)
+    store_assignment (assignments_pairs, that.assignment_indices[i], std::move (that.assignments_pairs[i]), NodePair (0, 0));
+  for (size_t i = 0; i != that.assignments_lists.size(); ++i)
+    store_assignment (assignments_lists, that.assignment_indices[i], std::move (that.assignments_lists[i]), vector<node_t>());
+}
+
+
+
+template <typename T>
+template <class AssignmentType>
+void Matrix<T>::store_assignment (vector<AssignmentType>& assignments, const size_t index, AssignmentType&& value, const AssignmentType& fill)
+{
+  if (is_thread_matrix) {
+    assignment_indices.push_back (index);
+    assignments.push_back (std::move (value));
+  } else if (index == assignments.size()) {
+    assignments.push_back (std::move (value));
+  } else {
+    if (index > assignments.size())
+      assignments.resize (index + 1, fill);
+    assignments[index] = std::move (value);
+  }
+}
+
+
+
 template <typename T>
 void Matrix<T>::apply_data (const size_t index, const T value, const T weight)
 {
@@ -16,6 +16,7 @@
 #ifndef __dwi_tractography_connectome_matrix_h__
 #define __dwi_tractography_connectome_matrix_h__
 
+#include <mutex>
 #include <set>
 
 #include "types.h"
@@ -24,6 +25,7 @@
 #include "connectome/mat2vec.h"
 #include "math/math.h"
 
+#include "dwi/tractography/connectome/assignments.h"
 #include "dwi/tractography/connectome/connectome.h"
 #include "dwi/tractography/connectome/mapped_track.h"
 
@@ -53,35 +55,25 @@ class Matrix
     using vector_type = Eigen::Matrix<T, Eigen::Dynamic, 1>;
 
     Matrix (const node_t max_node_index, const stat_edge stat, const bool vector_output, const bool track_assignments) :
-        statistic (stat),
-        vector_output (vector_output),
-        track_assignments (track_assignments),
-        mat2vec (vector_output ?
-                 nullptr :
-                 new MR::Connectome::Mat2Vec (max_node_index+1)),
-        data   (vector_type::Zero (vector_output ?
-                                   (max_node_index + 1) :
-                                   mat2vec->vec_size())),
-        counts (stat == stat_edge::MEAN ?
-                vector_type::Zero (vector_output ?
-                                   (max_node_index + 1) :
-                                   mat2vec->vec_size()) :
-                vector_type())
-    {
-      if (statistic == stat_edge::MIN)
-        data = vector_type::Constant (vector_output ? (max_node_index + 1) : mat2vec->vec_size(), std::numeric_limits<T>::infinity());
-      else if (statistic == stat_edge::MAX)
-        data = vector_type::Constant (vector_output ? (max_node_index + 1) : mat2vec->vec_size(), -std::numeric_limits<T>::infinity());
-    }
+        Matrix (max_node_index, stat, vector_output, track_assignments, false) { }
 
     bool operator() (const Mapped_track_nodepair&);
     bool operator() (const Mapped_track_nodelist&);
 
+    // For multi-threaded construction: provides an empty matrix with the same
+    //   configuration, into which a single thread can accumulate streamline
+    //   contributions; these are merged into this matrix by finalize().
+    // For very large connectomes, duplicating the matrix for every thread would
+    //   use too much RAM; all threads then instead share this matrix, and
+    //   access to it is serialised.
+    Matrix& thread_matrix();
+
     void finalize();
 
     void error_check (const std::set<node_t>&);
 
     void write_assignments (const std::string&) const;
+    void write_assignments_cache (const std::string&, const AssignmentsCache::Info&) const;
 
     bool is_vector() const { return (vector_output); }
 
@@ -96,10 +88,50 @@ class Matrix
     const std::unique_ptr<MR::Connectome::Mat2Vec> mat2vec;
 
     vector_type data, counts;
-    vector<node_t> assignments_single;
     vector<NodePair> assignments_pairs;
     vector< vector<node_t> > assignments_lists;
 
+    // For a per-thread matrix, assignments are stored in the order in which
+    //   streamlines are received, along with the corresponding track indices
+    const bool is_thread_matrix;
+    vector<size_t> assignment_indices;
+
+    // Decided on construction, so that it never changes while threads are
+    //   accessing the matrix
+    const bool is_shared;
+
+    vector<std::unique_ptr<Matrix>> thread_matrices;
+    std::mutex mutex;
+
+    Matrix (const node_t max_node_index, const stat_edge stat, const bool vector_output, const bool track_assignments, const bool is_thread_matrix) :
+        statistic (stat),
+        vector_output (vector_output),
+        track_assignments (track_assignments),
+        mat2vec (vector_output ?
+                 nullptr :
+                 new MR::Connectome::Mat2Vec (max_node_index+1)),
+        data   (vector_type::Zero (vector_output ?
+                                   (max_node_index + 1) :
+                                   mat2vec->vec_size())),
+        counts (stat == stat_edge::MEAN ?
+                vector_type::Zero (vector_output ?
+                                   (max_node_index + 1) :
+                                   mat2vec->vec_size()) :
+                vector_type()),
+        is_thread_matrix (is_thread_matrix),
+        is_shared (!is_thread_matrix && max_node_index >= node_count_ram_limit)
+    {
+      if (statistic == stat_edge::MIN)
+        data = vector_type::Constant (vector_output ? (max_node_index + 1) : mat2vec->vec_size(), std::numeric_limits<T>::infinity());
+      else if (statistic == stat_edge::MAX)
+        data = vector_type::Constant (vector_output ? (max_node_index + 1) : mat2vec->vec_size(), -std::numeric_limits<T>::infinity());
+    }
+
+    void merge (Matrix&);
+
+    template <class AssignmentType>
+    void store_assignment (vector<AssignmentType>&, const size_t, AssignmentType&&, const AssignmentType&);
+
     FORCE_INLINE void apply_data (const size_t, const T, const T);
     FORCE_INLINE void apply_data (const size_t, const size_t, const T, const T);
     FORCE_INLINE void apply_data (T&, const T, const T);
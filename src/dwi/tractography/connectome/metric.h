@@ -82,14 +82,17 @@ class Metric { MEMALIGN(Metric)
       else if (scale_by_invlength)
         result = (tck.size() > 1 ? (result / tck.calc_length()) : 0.0);
       if (scale_by_file) {
-        if (tck.index >= size_t(file_values.size()))
+        if (tck.index >= size_t(file_values->size()))
           throw Exception ("File " + file_path + " does not contain enough entries for this tractogram");
-        result *= file_values[tck.index];
+        result *= (*file_values)[tck.index];
       }
       return result;
     }
 
 
+    // Whether or not the streamline vertices contribute to the metric
+    bool requires_geometry() const { return (scale_by_length || scale_by_invlength); }
+
     void set_scale_length (const bool i = true) {
       if (i) assert (!scale_by_invlength);
       scale_by_length = i;
@@ -100,10 +103,9 @@ class Metric { MEMALIGN(Metric)
     }
     void set_scale_invnodevol (Image<node_t>& nodes, const bool i = true) {
       scale_by_invnodevol = i;
-      if (!i) {
-        node_volumes.resize (0);
+      node_volumes.resize (0);
+      if (!i)
         return;
-      }
       for (auto l = Loop() (nodes); l; ++l) {
         const node_t index = nodes.value();
         if (index >= node_volumes.size())
@@ -115,11 +117,11 @@ class Metric { MEMALIGN(Metric)
       scale_by_file = i;
       if (!i) {
         file_path.clear();
-        file_values.resize (0);
+        file_values.reset();
         return;
       }
       file_path = Path::basename (path);
-      file_values = MR::load_vector (path);
+      file_values = std::make_shared<Eigen::VectorXd> (MR::load_vector (path));
     }
 
 
@@ -127,7 +129,8 @@ class Metric { MEMALIGN(Metric)
     bool scale_by_length, scale_by_invlength, scale_by_invnodevol, scale_by_file;
     Eigen::VectorXd node_volumes;
     std::string file_path;
-    Eigen::VectorXd file_values;
+    // Shared between copies, since this may be very large
+    std::shared_ptr<Eigen::VectorXd> file_values;
 
 };
 
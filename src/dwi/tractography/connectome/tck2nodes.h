@@ -22,6 +22,7 @@
 #include "interp/linear.h"
 #include "interp/nearest.h"
 
+#include "dwi/tractography/connectome/assignments.h"
 #include "dwi/tractography/connectome/connectome.h"
 
 #include "dwi/tractography/streamline.h"
@@ -231,6 +232,38 @@ class Tck2nodes_all_voxels : public Tck2nodes_base
 
 
 
+// Class that provides the assignments previously determined for each streamline
+//   and stored in a file, rather than re-computing them; the streamline vertices
+//   are not used
+class Tck2nodes_cached : public Tck2nodes_base
+{ MEMALIGN(Tck2nodes_cached)
+  public:
+    Tck2nodes_cached (const Image<node_t>& nodes_data, const AssignmentsCache& cache) :
+        Tck2nodes_base (nodes_data, cache.provides_pair()),
+        cache          (cache) { }
+
+    Tck2nodes_cached (const Tck2nodes_cached& that) :
+        Tck2nodes_base (that),
+        cache          (that.cache) { }
+
+    ~Tck2nodes_cached() { }
+
+  private:
+    node_t select_node (const Tractography::Streamline<>& tck, Image<node_t>&, const bool end) const override {
+      const NodePair& nodes = cache.get_pair (tck.index);
+      return end ? nodes.second : nodes.first;
+    }
+
+    void select_nodes (const Streamline<>& tck, Image<node_t>&, vector<node_t>& out) const override {
+      out = cache.get_list (tck.index);
+    }
+
+    const AssignmentsCache& cache;
+
+};
+
+
+
 
 
 }
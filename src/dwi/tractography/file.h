@@ -16,6 +16,7 @@
 #ifndef __dwi_tractography_file_h__
 #define __dwi_tractography_file_h__
 
+#include <future>
 #include <map>
 
 #include "app.h"
@@ -316,6 +317,14 @@ namespace MR
           /*! \note \c buffer needs to be greater than \c num_points by one
            * element to add the barrier. */
           void commit (vector_type* data, size_t num_points) {
+            commit (data, num_points, count, total_count);
+          }
+
+          //! write track point data to file, recording the counts supplied
+          /*! this version is used when the data are written in the
+           * background, in which case the counts may already have moved on by
+           * the time the write completes. */
+          void commit (vector_type* data, size_t num_points, uint64_t num_written, uint64_t num_processed) {
             if (num_points == 0 || !open_success)
               return;
 
@@ -329,7 +338,7 @@ namespace MR
             out.seekp (prev_barrier_addr, out.beg);
             out.write (reinterpret_cast<const char* const> (data), sizeof(vector_type));
             verify_stream (out);
-            update_counts (out);
+            update_counts (out, num_written, num_processed);
           }
 
 
@@ -354,6 +363,14 @@ namespace MR
        * to file concurrently. The size of the write-back buffer defaults to
        * 16MB, and can be set in the config file using the
        * TrackWriterBufferSize field (in bytes).
+       *
+       * The buffer is double-buffered: once full, it is handed over to a
+       * background thread to be written to file, while the calling thread
+       * carries on filling the second buffer. The calling thread only needs to
+       * wait if the previous write has not yet completed by the time the
+       * second buffer is full. Any error encountered during a background write
+       * is thrown on the next commit; on destruction, it is instead reported
+       * and the command set to exit with an error code.
        * */
       template <typename ValueType = float>
         class Writer : public WriterUnbuffered<ValueType>
@@ -377,18 +394,43 @@ namespace MR
           //CONF The size of the write-back buffer (in bytes) to use when
           //CONF writing track files. MRtrix will store the output tracks in a
           //CONF relatively large buffer to limit the number of write() calls,
-          //CONF avoid associated issues such as file fragmentation.
+          //CONF avoid associated issues such as file fragmentation. Two such
+          //CONF buffers are used, so that one can be written to file in the
+          //CONF background while the other is being filled.
           Writer (const std::string& file, const Properties& properties, size_t default_buffer_capacity = 16777216) :
             WriterUnbuffered<ValueType> (file, properties),
             buffer_capacity (File::Config::get_int ("TrackWriterBufferSize", default_buffer_capacity) / sizeof (vector_type)),
             buffer (new vector_type [buffer_capacity]),
-            buffer_size (0) { }
+            buffer_size (0),
+            pending_buffer (new vector_type [buffer_capacity]),
+            pending_size (0),
+            pending_count (0),
+            pending_total_count (0) { }
 
           Writer (const Writer& W) = delete;
 
           //! commits any remaining data to file
+          /*! since exceptions cannot propagate out of the destructor, any
+           * error is reported here, and the command flagged for termination
+           * with an error code. */
           ~Writer() {
-            commit();
+            try {
+              commit();
+              wait_for_pending();
+            }
+            catch (Exception& E) {
+              // no need to report again if unwinding due to a previous error:
+              if (!std::uncaught_exception()) {
+                E.display();
+                FAIL ("error writing track file \"" + this->name + "\"");
+              }
+              App::exit_error_code = 1;
+            }
+            catch (...) {
+              if (!std::uncaught_exception())
+                FAIL ("error writing track file \"" + this->name + "\"");
+              App::exit_error_code = 1;
+            }
           }
 
           //! append track to file
@@ -403,7 +445,7 @@ namespace MR
             add_point (delimiter());
 
             if (weights_name.size())
-              weights_buffer += str (tck.weight) + ' ';
+              add_weight (tck.weight);
 
             ++count;
             ++total_count;
@@ -417,19 +459,50 @@ namespace MR
           size_t buffer_size;
           std::string weights_buffer;
 
+          std::unique_ptr<vector_type[]> pending_buffer;
+          size_t pending_size;
+          uint64_t pending_count, pending_total_count;
+          std::string pending_weights;
+          std::future<void> pending;
+
           //! add point to buffer and increment buffer_size accordingly
           void add_point (const vector_type& p) {
             format_point (p, buffer[buffer_size++]);
           }
 
+          //! append weight to buffer as text
+          /*! this produces the same output as str(), but without the overhead
+           * of constructing a std::ostringstream for every streamline. */
+          void add_weight (float weight) {
+            char text[32];
+            const int length = snprintf (text, sizeof (text), "%.*g", max_digits<float>::value(), weight);
+            weights_buffer.append (text, length);
+            weights_buffer += ' ';
+          }
+
+          //! hand the current buffers over to the background thread
           void commit () {
-            WriterUnbuffered<ValueType>::commit (buffer.get(), buffer_size);
+            wait_for_pending();
+            std::swap (buffer, pending_buffer);
+            pending_size = buffer_size;
             buffer_size = 0;
+            std::swap (weights_buffer, pending_weights);
+            weights_buffer.clear();
+            pending_count = count;
+            pending_total_count = total_count;
+            pending = std::async (std::launch::async, [this] { write_pending(); });
+          }
 
-            if (weights_name.size()) {
-              write_weights (weights_buffer);
-              weights_buffer.clear();
-            }
+          void write_pending () {
+            WriterUnbuffered<ValueType>::commit (pending_buffer.get(), pending_size, pending_count, pending_total_count);
+            if (weights_name.size())
+              write_weights (pending_weights);
+          }
+
+          //! wait for any background write to complete, and rethrow any error
+          void wait_for_pending () {
+            if (pending.valid())
+              pending.get();
           }
 
       };
@@ -140,8 +140,12 @@ namespace MR
             }
 
             void update_counts (File::OFStream& out) {
+              update_counts (out, count, total_count);
+            }
+
+            void update_counts (File::OFStream& out, uint64_t num_written, uint64_t num_processed) {
               out.seekp (count_offset);
-              out << count << "\ntotal_count: " << total_count << "\nEND\n";
+              out << num_written << "\ntotal_count: " << num_processed << "\nEND\n";
               verify_stream (out);
             }
         };
@@ -15,6 +15,8 @@
 
 #include "dwi/tractography/mapping/writer.h"
 
+#include "file/config.h"
+
 
 namespace MR {
 namespace DWI {
@@ -27,6 +29,27 @@ const char* writer_dims[] = { "undefined", "greyscale", "DEC", "dixel", "TOD", N
 
 
 
+size_t MapWriterBase::num_thread_buffers() const
+{
+  //CONF option: TrackMappingThreadBufferSize
+  //CONF default: 1073741824
+  //CONF The maximal amount of memory (in bytes) to allocate for additional
+  //CONF per-thread buffers when mapping streamlines to an image (e.g. in
+  //CONF tckmap). Each such buffer is a complete copy of the output image,
+  //CONF allowing streamlines to be accumulated by multiple threads
+  //CONF concurrently; if there is insufficient memory for even one
+  //CONF additional buffer, mapped streamlines are written to the output
+  //CONF image by a single thread.
+  const size_t threads = Thread::number_of_threads();
+  if (threads < 2)
+    return 1;
+  const int64_t limit = File::Config::get_int ("TrackMappingThreadBufferSize", 1073741824);
+  const int64_t size = std::max (buffer_footprint(), int64_t(1));
+  return std::min (threads, size_t (1 + std::max (limit, int64_t(0)) / size));
+}
+
+
+
 }
 }
 }
@@ -16,11 +16,14 @@
 #ifndef __dwi_tractography_mapping_writer_h__
 #define __dwi_tractography_mapping_writer_h__
 
+#include <mutex>
+
 #include "memory.h"
 #include "file/path.h"
 #include "file/utils.h"
 #include "image.h"
 #include "algo/loop.h"
+#include "algo/threaded_loop.h"
 #include "thread_queue.h"
 
 #include "dwi/tractography/mapping/twi_stats.h"
@@ -77,6 +80,15 @@ namespace MR {
             virtual bool operator() (const Gaussian::SetDixel&)    { return false; }
             virtual bool operator() (const Gaussian::SetVoxelTOD&) { return false; }
 
+            // For multi-threaded mapping: obtain a buffer into which a single thread
+            //   can accumulate mapped streamlines without synchronisation; these
+            //   buffers are owned by the writer, and combined during finalise()
+            virtual MapWriterBase& thread_buffer() = 0;
+
+            // The number of such buffers that can be used without exceeding the
+            //   memory limit set in the configuration file
+            size_t num_thread_buffers() const;
+
 
           protected:
             const Header& H;
@@ -90,10 +102,56 @@ namespace MR {
             // It's also hijacked to store per-voxel min/max factors in the case of TOD
             std::unique_ptr<Image<float>> counts;
 
+            virtual int64_t buffer_footprint() const = 0;
+
+        };
+
+
+
+        // Functor for use as a multi-threaded final stage of the mapping queue;
+        //   each copy obtains a buffer from the writer on first use, and accumulates
+        //   into it independently of all other threads
+        class MapWriterThread
+        { MEMALIGN(MapWriterThread)
+          public:
+            MapWriterThread (MapWriterBase& writer) :
+                writer (writer),
+                buffer (nullptr) { }
+            MapWriterThread (const MapWriterThread& that) :
+                writer (that.writer),
+                buffer (nullptr) { }
+
+            template <class Cont>
+            bool operator() (const Cont& in)
+            {
+              if (!buffer)
+                buffer = &writer.thread_buffer();
+              return (*buffer) (in);
+            }
+
+          private:
+            MapWriterBase& writer;
+            MapWriterBase* buffer;
         };
 
 
 
+        // Map streamlines from source into the writer, accumulating into as many
+        //   per-thread buffers as the memory limit permits
+        template <class SourceType, class TrackType, class MapperType, class SetType>
+        void run_queue (SourceType& source, const TrackType& tck, MapperType& mapper, const SetType& set, MapWriterBase& writer)
+        {
+          const size_t num_buffers = writer.num_thread_buffers();
+          if (num_buffers > 1) {
+            MapWriterThread sink (writer);
+            Thread::run_queue (source, Thread::batch (tck), Thread::multi (mapper), Thread::batch (set), Thread::multi (sink, num_buffers));
+          } else {
+            Thread::run_queue (source, Thread::batch (tck), Thread::multi (mapper), Thread::batch (set), writer);
+          }
+        }
+
+
+
 
 
 
@@ -104,7 +162,8 @@ namespace MR {
           public:
           MapWriter (const Header& header, const std::string& name, const vox_stat_t voxel_statistic = V_SUM, const writer_dim type = GREYSCALE) :
               MapWriterBase (header, name, voxel_statistic, type),
-              buffer (Image<value_type>::scratch (header, "TWI " + str(writer_dims[type]) + " buffer"))
+              buffer (Image<value_type>::scratch (header, "TWI " + str(writer_dims[type]) + " buffer")),
+              buffer_claimed (false)
           {
             auto loop = Loop (buffer);
             if (type == DEC || type == TOD) {
@@ -151,6 +210,13 @@ namespace MR {
 
           void finalise () override {
 
+            if (thread_writers.size()) {
+              // Bitwise storage can't be written concurrently by multiple threads;
+              //   run with all axes as inner axes so that a single thread is used
+              ThreadedLoop ("combining per-thread mapping buffers", buffer, 0, 3, std::is_same<value_type, bool>::value ? 3 : 1).run (Reducer (*this));
+              thread_writers.clear();
+            }
+
             auto loop = Loop (buffer, 0, 3);
             switch (voxel_statistic) {
 
@@ -247,9 +313,64 @@ namespace MR {
           bool operator() (const Gaussian::SetVoxelTOD& in) override { receive_tod       (in); return true; }
 
 
+          // The first thread to request a buffer accumulates directly into the
+          //   output buffer; subsequent threads each get a writer of their own
+          MapWriterBase& thread_buffer () override {
+            std::lock_guard<std::mutex> lock (mutex);
+            if (!buffer_claimed) {
+              buffer_claimed = true;
+              return *this;
+            }
+            thread_writers.push_back (std::unique_ptr<MapWriter> (new MapWriter (H, output_image_name, voxel_statistic, type)));
+            return *thread_writers.back();
+          }
+
+
           private:
           Image<value_type> buffer;
 
+          bool buffer_claimed;
+          vector<std::unique_ptr<MapWriter>> thread_writers;
+          std::mutex mutex;
+
+          int64_t buffer_footprint () const override {
+            return footprint<value_type> (voxel_count (buffer)) + (counts ? footprint<float> (voxel_count (*counts)) : 0);
+          }
+
+          // Combines the contents of the per-thread buffers into the output buffer
+          class Reducer
+          { MEMALIGN(Reducer)
+            public:
+              Reducer (MapWriter& master) :
+                  voxel_statistic (master.voxel_statistic),
+                  type (master.type),
+                  buffer (master.buffer),
+                  thread_counts (master.thread_writers.size())
+              {
+                if (master.counts)
+                  counts = *master.counts;
+                for (size_t n = 0; n != master.thread_writers.size(); ++n) {
+                  thread_buffers.push_back (master.thread_writers[n]->buffer);
+                  if (master.counts)
+                    thread_counts[n] = *master.thread_writers[n]->counts;
+                }
+              }
+
+              void operator() (const Iterator& pos);
+
+            private:
+              const vox_stat_t voxel_statistic;
+              const writer_dim type;
+              Image<value_type> buffer;
+              Image<float> counts;
+              vector<Image<value_type>> thread_buffers;
+              vector<Image<float>> thread_counts;
+              Eigen::Matrix<default_type, Eigen::Dynamic, 1> value, thread_value;
+
+              void combine_elements (Image<value_type>&, Image<float>&);
+              void combine_vectors  (Image<value_type>&, Image<float>&);
+          };
+
           // Template functions used so that the functors don't have to be written twice
           //   (once for standard TWI and one for Gaussian track-wise statistic)
           template <class Cont> void receive_greyscale (const Cont&);
@@ -439,6 +560,107 @@ namespace MR {
 
 
 
+        template <typename value_type>
+          void MapWriter<value_type>::Reducer::operator() (const Iterator& pos)
+          {
+            assign_pos_of (pos, 0, 3).to (buffer);
+            if (counts.valid())
+              assign_pos_of (pos, 0, 3).to (counts);
+            for (size_t n = 0; n != thread_buffers.size(); ++n) {
+              assign_pos_of (pos, 0, 3).to (thread_buffers[n]);
+              if (counts.valid())
+                assign_pos_of (pos, 0, 3).to (thread_counts[n]);
+              if (type == DEC || type == TOD)
+                combine_vectors (thread_buffers[n], thread_counts[n]);
+              else
+                combine_elements (thread_buffers[n], thread_counts[n]);
+            }
+          }
+
+
+
+        // Greyscale and dixel: each element of the buffer is independent
+        template <typename value_type>
+          void MapWriter<value_type>::Reducer::combine_elements (Image<value_type>& in, Image<float>& in_counts)
+          {
+            const ssize_t num_elements = buffer.ndim() > 3 ? buffer.size(3) : 1;
+            for (ssize_t i = 0; i != num_elements; ++i) {
+              if (buffer.ndim() > 3) {
+                buffer.index(3) = in.index(3) = i;
+                if (counts.valid())
+                  counts.index(3) = in_counts.index(3) = i;
+              }
+              switch (voxel_statistic) {
+                case V_SUM:
+                case V_MEAN:
+                  buffer.value() = default_type (buffer.value()) + default_type (in.value());
+                  if (counts.valid())
+                    counts.value() += in_counts.value();
+                  break;
+                case V_MIN: buffer.value() = std::min (value_type (buffer.value()), value_type (in.value())); break;
+                case V_MAX: buffer.value() = std::max (value_type (buffer.value()), value_type (in.value())); break;
+                default:
+                  throw Exception ("Unknown / unhandled voxel statistic in MapWriter::Reducer");
+              }
+            }
+          }
+
+
+
+        // DEC and TOD: for the minimum / maximum statistics, the whole vector
+        //   from one thread is selected, based on the same criteria as
+        //   receive_dec() and receive_tod()
+        template <typename value_type>
+          void MapWriter<value_type>::Reducer::combine_vectors (Image<value_type>& in, Image<float>& in_counts)
+          {
+            value.resize (buffer.size(3));
+            thread_value.resize (buffer.size(3));
+            for (auto l = Loop (3) (buffer, in); l; ++l) {
+              value[buffer.index(3)] = buffer.value();
+              thread_value[buffer.index(3)] = in.value();
+            }
+            bool replace = false;
+            switch (voxel_statistic) {
+              case V_SUM:
+              case V_MEAN:
+                value += thread_value;
+                if (counts.valid())
+                  counts.value() += in_counts.value();
+                replace = true;
+                break;
+              case V_MIN:
+                if (type == DEC) {
+                  replace = thread_value.squaredNorm() < value.squaredNorm();
+                } else if (in_counts.value() < counts.value()) {
+                  counts.value() = in_counts.value();
+                  replace = true;
+                }
+                if (replace)
+                  value = thread_value;
+                break;
+              case V_MAX:
+                if (type == DEC) {
+                  replace = thread_value.squaredNorm() > value.squaredNorm();
+                } else if (in_counts.value() > counts.value()) {
+                  counts.value() = in_counts.value();
+                  replace = true;
+                }
+                if (replace)
+                  value = thread_value;
+                break;
+              default:
+                throw Exception ("Unknown / unhandled voxel statistic in MapWriter::Reducer");
+            }
+            if (replace) {
+              for (auto l = Loop (3) (buffer); l; ++l)
+                buffer.value() = value[buffer.index(3)];
+            }
+          }
+
+
+
+
+
         template <>
         inline void MapWriter<bool>::add (const default_type weight, const default_type factor)
         {
@@ -500,8 +500,8 @@ namespace MR
               ssize_t nseg = data_offset / buffer->get_io()->segment_size();
               return fetch_func (buffer->get_io()->segment (nseg), data_offset - nseg*buffer->get_io()->segment_size(), buffer->intensity_offset(), buffer->intensity_scale());
             }
-            std::function<ValueType(const void*,size_t,default_type,default_type)> fetch_func;
-            std::function<void(ValueType,void*,size_t,default_type,default_type)> store_func;
+            ValueType (*fetch_func) (const void*,size_t,default_type,default_type);
+            void (*store_func) (ValueType,void*,size_t,default_type,default_type);
           } V (image);
 
           const size_t N = ( format == gl::RED ? 1 : 3 );
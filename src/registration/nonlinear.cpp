@@ -60,6 +60,10 @@ namespace MR
       + Option ("nl_grad_step", "the gradient step size for non-linear registration (Default: 0.5)")
         + Argument ("num").type_float (0.0001, 1.0)
 
+      + Option ("nl_velocity", "parametrise each non-linear warp by a stationary velocity field. The displacement fields and their inverses "
+                               "are then computed by scaling and squaring of the whole field, rather than by iterative per-voxel inversion. "
+                               "This option cannot be used in combination with -nl_init.")
+
       + Option ("nl_lmax", "explicitly set the lmax to be used per scale factor in non-linear FOD registration. By default FOD registration will "
                            "use lmax 0,2,4 with default scale factors 0.25,0.5,1.0 respectively. Note that no reorientation will be performed with lmax = 0.")
       + Argument ("num").type_sequence_int ();
@@ -52,6 +52,7 @@ namespace MR
           update_smoothing (2.0),
           disp_smoothing (1.0),
           gradient_step (0.5),
+          use_velocity (false),
           do_reorientation (false),
           fod_lmax (3) {
             scale_factor[0] = 0.25;
@@ -70,6 +71,9 @@ namespace MR
                     Im1MaskType& im1_mask,
                     Im2MaskType& im2_mask) {
 
+            if (is_initialised && use_velocity)
+              throw Exception ("velocity field parametrisation of the non-linear warp cannot be used when initialising with non-linear warps");
+
             if (!is_initialised) {
               im1_to_mid_linear = linear_transform.get_transform_half();
               im2_to_mid_linear = linear_transform.get_transform_half_inverse();
@@ -159,6 +163,10 @@ namespace MR
               im2_update = make_shared<Image<default_type>>(Image<default_type>::scratch (field_header));
               im1_update_new = make_shared<Image<default_type>>(Image<default_type>::scratch (field_header));
               im2_update_new = make_shared<Image<default_type>>(Image<default_type>::scratch (field_header));
+              if (use_velocity) {
+                im1_velocity_new = make_shared<Image<default_type>>(Image<default_type>::scratch (field_header));
+                im2_velocity_new = make_shared<Image<default_type>>(Image<default_type>::scratch (field_header));
+              }
 
               if (!is_initialised) {
                 if (level == 0) {
@@ -166,6 +174,10 @@ namespace MR
                   im2_to_mid = make_shared<Image<default_type>>(Image<default_type>::scratch (field_header));
                   mid_to_im1 = make_shared<Image<default_type>>(Image<default_type>::scratch (field_header));
                   mid_to_im2 = make_shared<Image<default_type>>(Image<default_type>::scratch (field_header));
+                  if (use_velocity) {
+                    im1_velocity = make_shared<Image<default_type>>(Image<default_type>::scratch (field_header));
+                    im2_velocity = make_shared<Image<default_type>>(Image<default_type>::scratch (field_header));
+                  }
                 } else {
                   DEBUG ("Upsampling fields");
                   {
@@ -174,6 +186,10 @@ namespace MR
                     im2_to_mid = reslice (*im2_to_mid, field_header);
                     mid_to_im1 = reslice (*mid_to_im1, field_header);
                     mid_to_im2 = reslice (*mid_to_im2, field_header);
+                    if (use_velocity) {
+                      im1_velocity = reslice (*im1_velocity, field_header);
+                      im2_velocity = reslice (*im2_velocity, field_header);
+                    }
                   }
                 }
               }
@@ -196,16 +212,33 @@ namespace MR
                 Image<default_type> im2_deform_field = Image<default_type>::scratch (field_header);
 
                 if (iteration > 1) {
-                  DEBUG ("updating displacement field");
-                  Warp::update_displacement_scaling_and_squaring (*im1_to_mid, *im1_update, *im1_to_mid_new, grad_step_altered);
-                  Warp::update_displacement_scaling_and_squaring (*im2_to_mid, *im2_update, *im2_to_mid_new, grad_step_altered);
-
-                  DEBUG ("smoothing displacement field");
-                  Filter::Smooth smooth_filter (*im1_to_mid_new);
-                  smooth_filter.set_stdev (disp_smoothing_mm);
-                  smooth_filter.set_zero_boundary (true);
-                  smooth_filter (*im1_to_mid_new);
-                  smooth_filter (*im2_to_mid_new);
+                  if (use_velocity) {
+                    DEBUG ("updating velocity field");
+                    update_velocity (*im1_velocity, *im1_update, *im1_velocity_new, grad_step_altered);
+                    update_velocity (*im2_velocity, *im2_update, *im2_velocity_new, grad_step_altered);
+
+                    DEBUG ("smoothing velocity field");
+                    Filter::Smooth smooth_filter (*im1_velocity_new);
+                    smooth_filter.set_stdev (disp_smoothing_mm);
+                    smooth_filter.set_zero_boundary (true);
+                    smooth_filter (*im1_velocity_new);
+                    smooth_filter (*im2_velocity_new);
+
+                    DEBUG ("integrating velocity field");
+                    Warp::integrate_velocity (*im1_velocity_new, *im1_to_mid_new);
+                    Warp::integrate_velocity (*im2_velocity_new, *im2_to_mid_new);
+                  } else {
+                    DEBUG ("updating displacement field");
+                    Warp::update_displacement_scaling_and_squaring (*im1_to_mid, *im1_update, *im1_to_mid_new, grad_step_altered);
+                    Warp::update_displacement_scaling_and_squaring (*im2_to_mid, *im2_update, *im2_to_mid_new, grad_step_altered);
+
+                    DEBUG ("smoothing displacement field");
+                    Filter::Smooth smooth_filter (*im1_to_mid_new);
+                    smooth_filter.set_stdev (disp_smoothing_mm);
+                    smooth_filter.set_zero_boundary (true);
+                    smooth_filter (*im1_to_mid_new);
+                    smooth_filter (*im2_to_mid_new);
+                  }
 
                   Registration::Warp::compose_linear_displacement (im1_to_mid_linear, *im1_to_mid_new, im1_deform_field);
                   Registration::Warp::compose_linear_displacement (im2_to_mid_linear, *im2_to_mid_new, im2_deform_field);
@@ -261,6 +294,10 @@ namespace MR
                   if (iteration > 1) {
                     std::swap (im1_to_mid_new, im1_to_mid);
                     std::swap (im2_to_mid_new, im2_to_mid);
+                    if (use_velocity) {
+                      std::swap (im1_velocity_new, im1_velocity);
+                      std::swap (im2_velocity_new, im2_velocity);
+                    }
                   }
                   std::swap (im1_update_new, im1_update);
                   std::swap (im2_update_new, im2_update);
@@ -268,8 +305,13 @@ namespace MR
                   DEBUG ("inverting displacement field");
                   {
                     LogLevelLatch level (0);
-                    Warp::invert_displacement (*im1_to_mid, *mid_to_im1);
-                    Warp::invert_displacement (*im2_to_mid, *mid_to_im2);
+                    if (use_velocity) {
+                      Warp::invert_velocity (*im1_velocity, *mid_to_im1);
+                      Warp::invert_velocity (*im2_velocity, *mid_to_im2);
+                    } else {
+                      Warp::invert_displacement (*im1_to_mid, *mid_to_im1);
+                      Warp::invert_displacement (*im2_to_mid, *mid_to_im2);
+                    }
                   }
 
 
@@ -369,6 +411,10 @@ namespace MR
             disp_smoothing = voxel_fwhm;
           }
 
+          void set_velocity_field (const bool use_velocity_field) {
+            use_velocity = use_velocity_field;
+          }
+
           void set_lmax (const vector<int>& lmax) {
             for (size_t i = 0; i < lmax.size (); ++i)
               if (lmax[i] < 0 || lmax[i] % 2)
@@ -424,6 +470,8 @@ namespace MR
             output_header.keyval()["nl_update_smooth"] = str(update_smoothing);
             output_header.keyval()["nl_disp_smooth"] = str(disp_smoothing);
             output_header.keyval()["nl_gradient_step"] = str(gradient_step);
+            if (use_velocity)
+              output_header.keyval()["nl_velocity"] = str(use_velocity);
             output_header.keyval()["fod_reorientation"] = str(do_reorientation);
             if (do_reorientation)
               output_header.keyval()["nl_lmax"] = str(fod_lmax);
@@ -456,6 +504,15 @@ namespace MR
             return temp;
           }
 
+          // The velocity fields are updated additively, which is a first order approximation
+          // to the composition of their exponentials (log-domain update)
+          void update_velocity (Image<default_type>& velocity, Image<default_type>& update, Image<default_type>& output, const default_type step) {
+            ThreadedLoop (velocity, 0, 3).run (
+                [&step](Image<default_type>& velocity, Image<default_type>& update, Image<default_type>& output) {
+                  output.row(3) = Eigen::Vector3 (velocity.row(3)) + step * Eigen::Vector3 (update.row(3));
+                }, velocity, update, output);
+          }
+
           bool has_negative_jacobians (Image<default_type>& field) {
             Adapter::Jacobian<Image<default_type> > jacobian (field);
             for (auto i = Loop (0,3) (jacobian); i; ++i) {
@@ -473,6 +530,7 @@ namespace MR
           default_type update_smoothing;
           default_type disp_smoothing;
           default_type gradient_step;
+          bool use_velocity;
           Eigen::MatrixXd aPSF_directions;
           bool do_reorientation;
           vector<int> fod_lmax;
@@ -489,6 +547,12 @@ namespace MR
           std::shared_ptr<Image<default_type> > mid_to_im1;
           std::shared_ptr<Image<default_type> > mid_to_im2;
 
+          // Only used if the warps are parametrised by stationary velocity fields
+          std::shared_ptr<Image<default_type> > im1_velocity_new;
+          std::shared_ptr<Image<default_type> > im2_velocity_new;
+          std::shared_ptr<Image<default_type> > im1_velocity;
+          std::shared_ptr<Image<default_type> > im2_velocity;
+
           std::shared_ptr<Image<default_type> > im1_update;
           std::shared_ptr<Image<default_type> > im2_update;
           std::shared_ptr<Image<default_type> > im1_update_new;
@@ -23,6 +23,7 @@
 #include "adapter/jacobian.h" //TODO remove after debug
 #include "registration/warp/helpers.h"
 #include "adapter/extract.h"
+#include "algo/threaded_copy.h"
 
 namespace MR
 {
@@ -66,6 +67,87 @@ namespace MR
             MR::Transform image_transform;
         };
 
+        // Tri-linear interpolation of a 3-vector field (stored along axis 3).
+        // This is equivalent to Interp::Linear::row(3), but the 8 neighbouring
+        // vectors are gathered into a fixed-size 3x8 matrix, so that the weighted
+        // sum is evaluated without any heap allocation and vectorised by Eigen.
+        // Composition of warps is dominated by this lookup.
+        class LinearFieldInterp { MEMALIGN(LinearFieldInterp)
+          public:
+            LinearFieldInterp (const Image<default_type>& field) :
+                               field (field),
+                               scanner2voxel (MR::Transform (field).scanner2voxel),
+                               bounds { field.size(0) - 0.5, field.size(1) - 0.5, field.size(2) - 0.5 } {
+              assert (field.ndim() == 4 && field.size(3) == 3);
+            }
+
+            //! returns false if \a pos lies outside of the field
+            bool scanner (const Eigen::Vector3& pos, Eigen::Vector3& result) {
+              const Eigen::Vector3 P = scanner2voxel * pos;
+              for (size_t i = 0; i < 3; ++i)
+                if (P[i] <= -0.5 || P[i] >= bounds[i])
+                  return false;
+
+              const ssize_t c[] = { ssize_t (std::floor (P[0])), ssize_t (std::floor (P[1])), ssize_t (std::floor (P[2])) };
+              Eigen::Vector3 f (P[0] - c[0], P[1] - c[1], P[2] - c[2]);
+              for (size_t i = 0; i < 3; ++i)
+                if (P[i] < 0.0 || P[i] > bounds[i] - 0.5)
+                  f[i] = 0.0;
+
+              Eigen::Matrix<default_type, 8, 1> weights;
+              Eigen::Matrix<default_type, 3, 8> neighbours;
+              size_t i = 0;
+              for (ssize_t z = 0; z < 2; ++z) {
+                field.index(2) = clamp (c[2] + z, field.size(2));
+                const default_type wz = z ? f[2] : 1.0 - f[2];
+                for (ssize_t y = 0; y < 2; ++y) {
+                  field.index(1) = clamp (c[1] + y, field.size(1));
+                  const default_type wyz = wz * (y ? f[1] : 1.0 - f[1]);
+                  for (ssize_t x = 0; x < 2; ++x, ++i) {
+                    field.index(0) = clamp (c[0] + x, field.size(0));
+                    weights[i] = wyz * (x ? f[0] : 1.0 - f[0]);
+                    for (ssize_t n = 0; n < 3; ++n) {
+                      field.index(3) = n;
+                      neighbours (n, i) = field.value();
+                    }
+                  }
+                }
+              }
+              result = neighbours * weights;
+              return true;
+            }
+
+          protected:
+            Image<default_type> field;
+            const transform_type scanner2voxel;
+            const default_type bounds[3];
+
+            static FORCE_INLINE ssize_t clamp (ssize_t x, ssize_t dim) {
+              return x < 0 ? 0 : ( x >= dim ? dim-1 : x );
+            }
+        };
+
+
+        class MaxNormKernel { MEMALIGN(MaxNormKernel)
+          public:
+            MaxNormKernel (default_type& overall_max, std::mutex& mutex) :
+                           overall_max (overall_max), mutex (mutex), max (0.0) { }
+            ~MaxNormKernel () {
+              std::lock_guard<std::mutex> lock (mutex);
+              overall_max = std::max (overall_max, max);
+            }
+
+            void operator() (Image<default_type>& field) {
+              max = std::max (max, Eigen::Vector3 (field.row(3)).norm());
+            }
+
+          protected:
+            default_type& overall_max;
+            std::mutex& mutex;
+            default_type max;
+        };
+
+
         class ComposeDispKernel { MEMALIGN(ComposeDispKernel)
           public:
             ComposeDispKernel (Image<default_type>& disp_input1, Image<default_type>& disp_input2, default_type step) :
@@ -76,19 +158,18 @@ namespace MR
               Eigen::Vector3 voxel ((default_type)disp_input1.index(0), (default_type)disp_input1.index(1), (default_type)disp_input1.index(2));
               Eigen::Vector3 voxel_position = disp1_transform.voxel2scanner * voxel;
               Eigen::Vector3 original_position = voxel_position + Eigen::Vector3(disp_input1.row(3));
-              disp2_interp.scanner (original_position);
-              if (!disp2_interp) {
+              Eigen::Vector3 displacement;
+              if (!disp2_interp.scanner (original_position, displacement)) {
                 disp_output.row(3) = disp_input1.row(3);
               } else {
-                Eigen::Vector3 displacement (Eigen::Vector3(disp2_interp.row(3)).array() * step);
-                Eigen::Vector3 new_position = displacement + original_position;
+                Eigen::Vector3 new_position = step * displacement + original_position;
                 disp_output.row(3) = new_position - voxel_position;
               }
             }
 
           protected:
             MR::Transform disp1_transform;
-            Interp::Linear<Image<default_type> > disp2_interp;
+            LinearFieldInterp disp2_interp;
             default_type step;
         };
 
@@ -154,63 +235,67 @@ namespace MR
         ThreadedLoop (input, 0, 3).run (ComposeDispKernel (input, update, step), input, output);
       }
 
+      // Return the largest vector norm within a field of 3-vectors (stored along axis 3)
+      FORCE_INLINE default_type max_vector_norm (Image<default_type>& field)
+      {
+        default_type max_norm = 0.0;
+        std::mutex mutex;
+        ThreadedLoop (field, 0, 3).run (MaxNormKernel (max_norm, mutex), field);
+        return max_norm;
+      }
+
+
+      // Compute the displacement field corresponding to the exponential of the stationary velocity field
+      // (scaled by step) using scaling and squaring: the velocity is scaled down by 2^N such that the
+      // maximum displacement is below half a voxel, and then composed with itself N times.
+      // Using step = -1.0 yields the inverse of the displacement obtained with step = 1.0.
+      // The input and output can be the same image.
+      FORCE_INLINE void integrate_velocity (Image<default_type>& velocity, Image<default_type>& displacement, const default_type step = 1.0)
+      {
+        check_dimensions (velocity, displacement, 0, 3);
+
+        const default_type max_norm = max_vector_norm (velocity);
+        default_type min_vox_size = static_cast<default_type> (std::min (velocity.spacing(0), std::min (velocity.spacing(1), velocity.spacing(2))));
+
+        size_t num_squarings = 0;
+        if (max_norm * std::abs (step) >= min_vox_size / 2.0)
+          num_squarings = std::ceil (std::log2 ((max_norm * std::abs (step)) / (min_vox_size / 2.0)));
+        const default_type scaled_step = step / std::pow (2.0, num_squarings);
+
+        std::shared_ptr<Image<default_type>> scaled = make_shared<Image<default_type>> (Image<default_type>::scratch (velocity));
+        std::shared_ptr<Image<default_type>> composed = make_shared<Image<default_type>> (Image<default_type>::scratch (velocity));
+
+        // Scaling
+        ThreadedLoop (velocity, 0, 3).run (
+              [&scaled_step](Image<default_type>& velocity, Image<default_type>& scaled) {
+                scaled.row(3) = Eigen::Vector3 (velocity.row(3)) * scaled_step;
+              }, velocity, *scaled);
+
+        // Squaring
+        for (size_t i = 0; i < num_squarings; ++i) {
+          update_displacement (*scaled, *scaled, *composed);
+          std::swap (scaled, composed);
+        }
+
+        threaded_copy (*scaled, displacement);
+      }
+
+
       // Compose two displacement fields and output a displacement field using scaling and squaring.  The input and output can be the same image.
       FORCE_INLINE  void update_displacement_scaling_and_squaring (Image<default_type>& input, Image<default_type>& update, Image<default_type>& output, const default_type step = 1.0)
       {
         check_dimensions (input, output, 0, 3);
 
-        default_type max_norm = 0.0;
-        auto max_norm_func = [&max_norm](Image<default_type>& update) {
-          default_type norm = Eigen::Vector3 (update.row(3)).norm();
-          if (norm > max_norm)
-            max_norm = norm;
-        };
-        ThreadedLoop (update).run (max_norm_func, update);
+        const default_type max_norm = max_vector_norm (update);
         default_type min_vox_size = static_cast<default_type> (std::min (input.spacing(0), std::min (input.spacing(1), input.spacing(2))));
 
         // if the maximum update is larger than half a voxel, perform scaling and squaring to ensure the displacement field remains diffeomorphic
-
-        default_type scale_factor = 1.0;
         if (max_norm * step < min_vox_size / 2.0) {
           update_displacement (input, update, output, step);
         } else {
-          scale_factor = std::pow (2, std::ceil (std::log ((max_norm * step) / (min_vox_size / 2.0)) / std::log (2.0)));
-
-          std::shared_ptr<Image<default_type>> scaled_update = make_shared<Image<default_type> >(Image<default_type>::scratch (update));
-          std::shared_ptr<Image<default_type>> composed = make_shared<Image<default_type> >(Image<default_type>::scratch (update));
-
-          // Scaling
-          default_type scaled_step = step / scale_factor; // apply the step size and scale factor at once
-          ThreadedLoop (update).run (
-                [&scaled_step](Image<default_type>& update, Image<default_type>& scaled_update) {
-                  scaled_update.row(3) = Eigen::Vector3 (update.row(3)) * scaled_step;
-                }, update, *scaled_update);
-
-//          CONSOLE ("composing " + str(std::log2 (scale_factor)) + "times");
-
-          // Squaring
-          for (size_t i = 0; i < std::log2 (scale_factor); ++i) {
-            update_displacement (*scaled_update, *scaled_update, *composed);
-            std::swap (scaled_update, composed);
-          }
-//          save (*scaled_update, std::string("composed_update.mif"), false);
-//          Adapter::Jacobian<Image<default_type> > jacobian (*scaled_update);
-//          Header header (*scaled_update);
-//          header.ndim() = 3;
-//          bool is_neg = false;
-//          auto jacobian_det = Image<default_type>::scratch (header);
-//          Eigen::MatrixXd ident = Eigen::MatrixXd::Identity (3,3);
-//          for (auto i = Loop (0,3) (jacobian, jacobian_det); i; ++i) {
-//            auto jac_matrix = ident + jacobian.value();
-//            jacobian_det.value() = jac_matrix.determinant();
-//            if (jacobian_det.value() < 0.0)
-//              is_neg = true;
-//          }
-//          save (jacobian_det, std::string("jacobian.mif"), false);
-//          if (is_neg)
-//            throw Exception ("negative jacobians in update");
-
-          update_displacement (input, *scaled_update, output);
+          auto exp_update = Image<default_type>::scratch (update);
+          integrate_velocity (update, exp_update, step);
+          update_displacement (input, exp_update, output);
         }
       }
 
@@ -20,6 +20,7 @@
 #include "interp/linear.h"
 #include "algo/threaded_loop.h"
 #include "registration/warp/convert.h"
+#include "registration/warp/compose.h"
 #include "transform.h"
 
 namespace MR
@@ -164,6 +165,16 @@ namespace MR
           }
 
 
+          /*! Compute the inverse of the displacement field parametrised by a stationary velocity field
+           * Since the forward displacement is exp(velocity), its inverse is exp(-velocity), which is obtained
+           * by scaling and squaring over the whole field rather than by per-voxel fixed-point iteration.
+           */
+          FORCE_INLINE void invert_velocity (Image<default_type>& velocity, Image<default_type>& inv_disp_field)
+          {
+            integrate_velocity (velocity, inv_disp_field, -1.0);
+          }
+
+
       //! @}
     }
   }
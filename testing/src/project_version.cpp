@@ -0,0 +1,11 @@
+
+namespace MR {
+  namespace App {
+    extern const char* project_version;
+    extern const char* project_build_date;
+    void set_project_version () {
+      project_version = "76324ea7";
+      project_build_date = __DATE__;
+    }
+  }
+}